@@ -12,5 +12,7 @@ enum GameState {
 	hard_g,
 	create_g,
 	join_g,
+	watch_g,
+	replay_g,
 	TODO_m
 };
@@ -0,0 +1,103 @@
+#include <immintrin.h>
+#include "accumulate.h"
+
+// Both versions keep bit-sliced counters: plane k holds bit k of the count
+// of every cell, so adding a layout is a ripple-carry add of one bit into
+// the planes (two planes touched on average). The planes are turned into
+// plain counts once per batch.
+
+namespace {
+
+const int planes_num = 16;
+const size_t batch = (size_t(1) << planes_num) - 1;
+
+void flush(const uint64_t (&lo)[planes_num], const uint64_t (&hi)[planes_num], uint32_t* counts) {
+	for (int k = 0; k < planes_num; k++) {
+		for (uint64_t w = lo[k]; w != 0; w &= w - 1) {
+			counts[__builtin_ctzll(w)] += uint32_t(1) << k;
+		}
+		for (uint64_t w = hi[k]; w != 0; w &= w - 1) {
+			counts[64 + __builtin_ctzll(w)] += uint32_t(1) << k;
+		}
+	}
+}
+
+}
+
+void accumulate_scalar(const Bitboard* layouts, size_t n, uint32_t* counts) {
+	while (n > 0) {
+		size_t m = n < batch ? n : batch;
+		uint64_t lo[planes_num] = {};
+		uint64_t hi[planes_num] = {};
+
+		for (size_t i = 0; i < m; i++) {
+			uint64_t carry_lo = layouts[i].lo;
+			uint64_t carry_hi = layouts[i].hi;
+			for (int k = 0; (carry_lo | carry_hi) != 0; k++) {
+				uint64_t t_lo = lo[k] & carry_lo;
+				uint64_t t_hi = hi[k] & carry_hi;
+				lo[k] ^= carry_lo;
+				hi[k] ^= carry_hi;
+				carry_lo = t_lo;
+				carry_hi = t_hi;
+			}
+		}
+
+		flush(lo, hi, counts);
+		layouts += m;
+		n -= m;
+	}
+}
+
+// two layouts per 256-bit register: {a.lo, a.hi, b.lo, b.hi}
+__attribute__((target("avx2")))
+void accumulate_avx2(const Bitboard* layouts, size_t n, uint32_t* counts) {
+	while (n > 1) {
+		size_t m = (n < batch ? n : batch) & ~size_t(1);
+		__m256i planes[planes_num];
+		for (int k = 0; k < planes_num; k++) {
+			planes[k] = _mm256_setzero_si256();
+		}
+
+		for (size_t i = 0; i < m; i += 2) {
+			__m256i carry = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(layouts + i));
+			for (int k = 0; !_mm256_testz_si256(carry, carry); k++) {
+				__m256i t = _mm256_and_si256(planes[k], carry);
+				planes[k] = _mm256_xor_si256(planes[k], carry);
+				carry = t;
+			}
+		}
+
+		alignas(32) uint64_t words[planes_num][4];
+		for (int k = 0; k < planes_num; k++) {
+			_mm256_store_si256(reinterpret_cast<__m256i*>(words[k]), planes[k]);
+		}
+		for (int half = 0; half < 4; half += 2) {
+			uint64_t lo[planes_num];
+			uint64_t hi[planes_num];
+			for (int k = 0; k < planes_num; k++) {
+				lo[k] = words[k][half];
+				hi[k] = words[k][half + 1];
+			}
+			flush(lo, hi, counts);
+		}
+
+		layouts += m;
+		n -= m;
+	}
+
+	accumulate_scalar(layouts, n, counts);
+}
+
+bool has_avx2() {
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+}
+
+void accumulate(const Bitboard* layouts, size_t n, uint32_t* counts) {
+	if (has_avx2()) {
+		accumulate_avx2(layouts, n, counts);
+	} else {
+		accumulate_scalar(layouts, n, counts);
+	}
+}
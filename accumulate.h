@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "board.h"
+
+// counts[i] += number of the n layouts that have cell i set, counts holds 100 cells;
+// picks the AVX2 version when the CPU has it
+void accumulate(const Bitboard* layouts, size_t n, uint32_t* counts);
+
+void accumulate_scalar(const Bitboard* layouts, size_t n, uint32_t* counts);
+
+void accumulate_avx2(const Bitboard* layouts, size_t n, uint32_t* counts);
+
+bool has_avx2();
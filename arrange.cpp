@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "arrange.h"
+#include "bots.h"
+#include "placement.h"
+#include "pool.h"
+
+namespace {
+
+const int batch = 256;
+
+// the coolest fleet a worker has seen, index is the candidate's number
+struct alignas(64) Best {
+	int score = -1;
+	uint64_t index = 0;
+	Bitboard ships[fleet_size];
+};
+
+}
+
+void Heatmap::set(int cell, int heat) {
+	for (int k = 0; k < 4; k++) {
+		if (heat >> k & 1) {
+			planes[k] |= Bitboard::bit(cell);
+		} else {
+			planes[k] &= ~Bitboard::bit(cell);
+		}
+	}
+}
+
+int Heatmap::heat(int cell) const {
+	int h = 0;
+	for (int k = 0; k < 4; k++) {
+		h |= int(planes[k].test(cell)) << k;
+	}
+	return h;
+}
+
+bool measure_heatmap(const std::string &shooter, uint64_t seed, uint64_t games, int threads, Heatmap &heat) {
+	if (!make_bot(shooter, 0)) {
+		return false;
+	}
+
+	// sums of the turn every cell was shot at, 100 for cells never shot
+	std::vector<std::vector<uint64_t>> turns(std::max(1, threads), std::vector<uint64_t>(100));
+	parallel_for(games, threads, 16, [&](int worker, uint64_t begin, uint64_t end) {
+		for (uint64_t i = begin; i < end; i++) {
+			EasyPlayer target(stream_seed(seed, 2 * i));
+			std::unique_ptr<AbstractPlayer> bot = make_bot(shooter, stream_seed(seed, 2 * i + 1));
+			target.arrange_ships();
+			bot->arrange_ships();
+
+			int turn[100];
+			std::fill(turn, turn + 100, 100);
+			for (int shots = 0; target.field_m.alive_ships_num > 0; shots++) {
+				Coord shot = bot->take_shot();
+				turn[shot.y * 10 + shot.x] = shots;
+				bot->get_res(target.get_shot(shot), shot);
+			}
+			for (int c = 0; c < 100; c++) {
+				turns[worker][c] += turn[c];
+			}
+		}
+	});
+
+	uint64_t total[100] = {};
+	for (const std::vector<uint64_t> &t : turns) {
+		for (int c = 0; c < 100; c++) {
+			total[c] += t[c];
+		}
+	}
+	uint64_t earliest = *std::min_element(total, total + 100);
+	uint64_t latest = *std::max_element(total, total + 100);
+	heat = Heatmap();
+	for (int c = 0; c < 100; c++) {
+		heat.set(c, latest == earliest ? 0 : int((latest - total[c]) * 15 / (latest - earliest)));
+	}
+	return true;
+}
+
+void score_layouts(const Heatmap &heat, const Bitboard* layouts, int n, int* scores) {
+	for (int i = 0; i < n; i++) {
+		scores[i] = heat.score(layouts[i]);
+	}
+}
+
+void arrange_against(const Heatmap &heat, Rng &rng, int candidates, int threads, Bitboard* ships) {
+	candidates = std::max(1, candidates);
+	threads = std::max(1, threads);
+	uint64_t base = rng();
+	uint64_t batches = (candidates + batch - 1) / batch;
+
+	// batch b is drawn from its own seed, any worker may take it
+	std::vector<Best> best(threads);
+	parallel_for(batches, threads, 1, [&](int worker, uint64_t begin, uint64_t end) {
+		std::vector<Bitboard> fleets(batch * fleet_size);
+		Bitboard layouts[batch];
+		int scores[batch];
+		for (uint64_t b = begin; b < end; b++) {
+			Rng batch_rng(stream_seed(base, b));
+			int n = std::min<uint64_t>(batch, candidates - b * batch);
+			for (int i = 0; i < n; i++) {
+				Bitboard* fleet = &fleets[i * fleet_size];
+				random_fleet(batch_rng, fleet);
+				layouts[i] = Bitboard();
+				for (int s = 0; s < fleet_size; s++) {
+					layouts[i] |= fleet[s];
+				}
+			}
+			score_layouts(heat, layouts, n, scores);
+
+			Best &mine = best[worker];
+			for (int i = 0; i < n; i++) {
+				uint64_t index = b * batch + i;
+				if (mine.score == -1 || scores[i] < mine.score || (scores[i] == mine.score && index < mine.index)) {
+					mine.score = scores[i];
+					mine.index = index;
+					std::copy(&fleets[i * fleet_size], &fleets[(i + 1) * fleet_size], mine.ships);
+				}
+			}
+		}
+	});
+
+	// the lowest score, the first candidate of them on ties
+	const Best* winner = nullptr;
+	for (const Best &b : best) {
+		if (b.score != -1 && (winner == nullptr || b.score < winner->score
+				|| (b.score == winner->score && b.index < winner->index))) {
+			winner = &b;
+		}
+	}
+	std::copy(winner->ships, winner->ships + fleet_size, ships);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "board.h"
+#include "rng.h"
+
+// Arranging the fleet against a known shooter. What the shooter does is
+// boiled down to a heatmap of how early it tends to fire at every cell,
+// measured over many games against random fleets. A layout scores the heat
+// of the cells its ships cover, and the fleet is the coolest of many
+// random ones: it stays random, but keeps away from where the shooter
+// looks first.
+
+// heat 0..15 of every cell, bit k of a cell's heat is in planes[k], so a
+// layout is scored with 8 popcounts whatever cells it covers
+struct Heatmap {
+	Bitboard planes[4];
+
+	void set(int cell, int heat);
+
+	int heat(int cell) const;
+
+	int score(Bitboard layout) const {
+		return (layout & planes[0]).count() + ((layout & planes[1]).count() << 1)
+			+ ((layout & planes[2]).count() << 2) + ((layout & planes[3]).count() << 3);
+	}
+};
+
+// plays the bot (see make_bot) against the given number of random fleets on
+// the given number of threads; the cells it shoots at the earliest on
+// average get heat 15, the latest 0. False if there is no such bot
+bool measure_heatmap(const std::string &shooter, uint64_t seed, uint64_t games, int threads, Heatmap &heat);
+
+void score_layouts(const Heatmap &heat, const Bitboard* layouts, int n, int* scores);
+
+// the lowest scoring of the given number of random fleets, ships in
+// fleet_lens order; the candidates are drawn and scored in batches spread
+// over the threads, the fleet depends on the rng only
+void arrange_against(const Heatmap &heat, Rng &rng, int candidates, int threads, Bitboard* ships);
@@ -0,0 +1,111 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "assets.h"
+
+// the assembler copies the files into the read only data of this object;
+// it looks for them in its include path, the build adds the source
+// directory to it
+#define EMBED(name, file) \
+	asm(".pushsection .rodata\n" \
+		".global " #name "_begin\n" \
+		".hidden " #name "_begin\n" \
+		#name "_begin:\n" \
+		".incbin \"" file "\"\n" \
+		".global " #name "_end\n" \
+		".hidden " #name "_end\n" \
+		#name "_end:\n" \
+		".popsection\n"); \
+	extern "C" const char name##_begin[]; \
+	extern "C" const char name##_end[];
+
+EMBED(battleship_help_txt, "help.txt")
+EMBED(battleship_win_txt, "win.txt")
+EMBED(battleship_lose_txt, "lose.txt")
+
+namespace {
+
+struct Embedded {
+	const char* file;
+	const char* begin;
+	const char* end;
+};
+
+const Embedded embedded[assets_num] = {
+	{"help.txt", battleship_help_txt_begin, battleship_help_txt_end},
+	{"win.txt", battleship_win_txt_begin, battleship_win_txt_end},
+	{"lose.txt", battleship_lose_txt_begin, battleship_lose_txt_end},
+};
+
+struct Store {
+	Store() {
+		load(nullptr);
+	}
+
+	void load(const char* dir) {
+		for (int i = 0; i < assets_num; i++) {
+			std::string_view text(embedded[i].begin, embedded[i].end - embedded[i].begin);
+			if (dir != nullptr && *dir != '\0') {
+				std::ifstream in(std::string(dir) + "/" + embedded[i].file, std::ios::binary);
+				if (in.is_open()) {
+					std::ostringstream read;
+					read << in.rdbuf();
+					replaced[i] = read.str();
+					text = replaced[i];
+				}
+			}
+			texts[i] = TextAsset(text);
+		}
+	}
+
+	// the files that replaced the built in texts, the views point here
+	std::string replaced[assets_num];
+	TextAsset texts[assets_num];
+};
+
+Store &store() {
+	static Store s;
+	return s;
+}
+
+}
+
+TextAsset::TextAsset(std::string_view text) : text(text) {
+	for (size_t i = 0; i < text.size(); i++) {
+		if (text[i] == '\n') {
+			starts.push_back(i + 1);
+		}
+	}
+	// the last line may have no line break
+	if (starts.back() != text.size()) {
+		starts.push_back(text.size());
+	}
+}
+
+std::string_view TextAsset::line(size_t i) const {
+	std::string_view l = text.substr(starts[i], starts[i + 1] - starts[i]);
+	while (!l.empty() && (l.back() == '\n' || l.back() == '\r')) {
+		l.remove_suffix(1);
+	}
+	return l;
+}
+
+size_t TextAsset::pages(size_t page_lines) const {
+	if (page_lines == 0 || lines() == 0) {
+		return 1;
+	}
+	return (lines() + page_lines - 1) / page_lines;
+}
+
+std::string_view TextAsset::page_line(size_t page, size_t i, size_t page_lines) const {
+	size_t n = page * page_lines + i;
+	return n < lines() ? line(n) : std::string_view();
+}
+
+void load_assets(const char* dir) {
+	store().load(dir);
+}
+
+const TextAsset &asset(Asset a) {
+	return store().texts[int(a)];
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// The texts the interface shows. They are built into the program, so it
+// runs from any directory; a directory given at startup may hold files of
+// the same names that replace them. Every text is split into lines once,
+// the screens then only look the lines up.
+
+enum class Asset {
+	help,
+	win,
+	lose
+};
+
+const int assets_num = 3;
+
+struct TextAsset {
+	TextAsset() = default;
+
+	explicit TextAsset(std::string_view text);
+
+	size_t lines() const {
+		return starts.size() - 1;
+	}
+
+	// without the line break
+	std::string_view line(size_t i) const;
+
+	// pages of page_lines lines each, at least one even for an empty text
+	size_t pages(size_t page_lines) const;
+
+	// line i of the page, empty past the end of the text
+	std::string_view page_line(size_t page, size_t i, size_t page_lines) const;
+
+	std::string_view text;
+
+private:
+	// line i is text[starts[i], starts[i + 1]) with its line break
+	std::vector<uint32_t> starts = {0};
+};
+
+// replaces the built in texts with the files in dir that have their names
+// (help.txt, win.txt, lose.txt); nullptr or "" keeps the built in ones
+void load_assets(const char* dir);
+
+const TextAsset &asset(Asset a);
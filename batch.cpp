@@ -0,0 +1,219 @@
+#include <immintrin.h>
+#include "accumulate.h"
+#include "batch.h"
+#include "placement.h"
+#include "rng.h"
+
+// Every step has three passes over the lanes: drawing the random numbers
+// and turning the shot hit or not into a swap of the sides are plain
+// arithmetic on arrays and get vectorized, finding the n-th unshot cell
+// is done lane by lane. Lanes with no game left play dummy games that are
+// thrown away.
+
+namespace {
+
+constexpr int lanes = 16;
+constexpr uint64_t no_game = ~uint64_t(0);
+
+// one side of every game, the arrays are indexed by lane
+struct alignas(64) Side {
+	uint64_t rng[4][lanes];
+	uint64_t ships_lo[lanes]; // own fleet
+	uint64_t ships_hi[lanes];
+	uint64_t shot_lo[lanes]; // cells shot at on the other side's field
+	uint64_t shot_hi[lanes];
+	uint64_t shots[lanes];
+	uint64_t hits[lanes];
+	uint64_t bot[lanes]; // 1 or 2
+
+	void load(int lane, const Rng &r, Bitboard ships, uint64_t bot_num) {
+		for (int k = 0; k < 4; k++) {
+			rng[k][lane] = r.state()[k];
+		}
+		ships_lo[lane] = ships.lo;
+		ships_hi[lane] = ships.hi;
+		shot_lo[lane] = 0;
+		shot_hi[lane] = 0;
+		shots[lane] = 0;
+		hits[lane] = 0;
+		bot[lane] = bot_num;
+	}
+};
+
+struct Batch {
+	Side mover; // the side to shoot
+	Side waiting;
+	uint64_t game[lanes];
+
+	uint64_t seed;
+	uint64_t next;
+	uint64_t end;
+	int playing = 0;
+
+	// the next game into the lane, or a dummy one: every shot of a dummy
+	// game hits, so it ends after 20 shots
+	void start(int lane) {
+		if (next == end) {
+			Rng none;
+			mover.load(lane, none, Bitboard::full(), 0);
+			waiting.load(lane, none, Bitboard::full(), 0);
+			game[lane] = no_game;
+			return;
+		}
+
+		uint64_t i = next++;
+		Rng rng1(stream_seed(seed, 2 * i));
+		Rng rng2(stream_seed(seed, 2 * i + 1));
+		Bitboard fleet1 = arrange(rng1);
+		Bitboard fleet2 = arrange(rng2);
+		if (i % 2 == 0) {
+			mover.load(lane, rng1, fleet1, 1);
+			waiting.load(lane, rng2, fleet2, 2);
+		} else {
+			mover.load(lane, rng2, fleet2, 2);
+			waiting.load(lane, rng1, fleet1, 1);
+		}
+		game[lane] = i;
+		playing++;
+	}
+
+	static Bitboard arrange(Rng &rng) {
+		Bitboard ships[fleet_size];
+		random_fleet(rng, ships);
+		Bitboard all;
+		for (const Bitboard &ship : ships) {
+			all |= ship;
+		}
+		return all;
+	}
+
+	void finish(int lane, uint64_t begin, GameOutcome* out) {
+		if (game[lane] != no_game) {
+			out[game[lane] - begin] = GameOutcome{uint8_t(mover.bot[lane]),
+				uint16_t(mover.shots[lane] + waiting.shots[lane])};
+			playing--;
+		}
+		start(lane);
+	}
+};
+
+inline uint64_t rotl(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+__attribute__((target("bmi2")))
+inline uint64_t nth_pdep(uint64_t lo, uint64_t hi, uint64_t n) {
+	// without a branch, which word holds the cell is a coin flip
+	uint64_t c = __builtin_popcountll(lo);
+	bool in_hi = n >= c;
+	uint64_t word = in_hi ? hi : lo;
+	uint64_t k = in_hi ? n - c : n;
+	return (in_hi ? 64 : 0) + __builtin_ctzll(_pdep_u64(uint64_t(1) << k, word));
+}
+
+// one shot in every lane, true if some game is over
+template <bool bmi2>
+__attribute__((always_inline))
+inline bool step(Batch &b) {
+	Side &m = b.mover;
+	Side &w = b.waiting;
+
+	// Rng::below of the mover's generator over its unshot cells
+	uint64_t pick[lanes];
+	for (int l = 0; l < lanes; l++) {
+		uint64_t r = rotl(m.rng[1][l] * 5, 7) * 9;
+		uint64_t t = m.rng[1][l] << 17;
+		m.rng[2][l] ^= m.rng[0][l];
+		m.rng[3][l] ^= m.rng[1][l];
+		m.rng[1][l] ^= m.rng[2][l];
+		m.rng[0][l] ^= m.rng[3][l];
+		m.rng[2][l] ^= t;
+		m.rng[3][l] = rotl(m.rng[3][l], 45);
+		pick[l] = ((r >> 32) * (100 - m.shots[l])) >> 32;
+	}
+
+	uint64_t cell[lanes];
+	for (int l = 0; l < lanes; l++) {
+		uint64_t free_lo = ~m.shot_lo[l];
+		uint64_t free_hi = ~m.shot_hi[l] & Bitboard::hi_mask;
+		if constexpr (bmi2) {
+			cell[l] = nth_pdep(free_lo, free_hi, pick[l]);
+		} else {
+			cell[l] = Bitboard{free_lo, free_hi}.nth(int(pick[l]));
+		}
+	}
+
+	uint64_t over = 0;
+	for (int l = 0; l < lanes; l++) {
+		uint64_t bit_lo = uint64_t(cell[l] < 64) << (cell[l] & 63);
+		uint64_t bit_hi = uint64_t(cell[l] >= 64) << (cell[l] & 63);
+		m.shot_lo[l] |= bit_lo;
+		m.shot_hi[l] |= bit_hi;
+		m.shots[l]++;
+		uint64_t hit = ((w.ships_lo[l] & bit_lo) | (w.ships_hi[l] & bit_hi)) != 0;
+		m.hits[l] += hit;
+		over |= m.hits[l] == 20;
+
+		// on a miss the sides change places
+		uint64_t swap = hit - 1;
+		auto exchange = [&](uint64_t &a, uint64_t &c) {
+			uint64_t x = (a ^ c) & swap;
+			a ^= x;
+			c ^= x;
+		};
+		for (int k = 0; k < 4; k++) {
+			exchange(m.rng[k][l], w.rng[k][l]);
+		}
+		exchange(m.ships_lo[l], w.ships_lo[l]);
+		exchange(m.ships_hi[l], w.ships_hi[l]);
+		exchange(m.shot_lo[l], w.shot_lo[l]);
+		exchange(m.shot_hi[l], w.shot_hi[l]);
+		exchange(m.shots[l], w.shots[l]);
+		exchange(m.hits[l], w.hits[l]);
+		exchange(m.bot[l], w.bot[l]);
+	}
+	return over != 0;
+}
+
+template <bool bmi2>
+__attribute__((always_inline))
+inline void play(uint64_t seed, uint64_t begin, uint64_t end, GameOutcome* out) {
+	Batch b;
+	b.seed = seed;
+	b.next = begin;
+	b.end = end;
+	for (int l = 0; l < lanes; l++) {
+		b.start(l);
+	}
+
+	while (b.playing > 0) {
+		if (step<bmi2>(b)) {
+			// the winner keeps the turn, so it's still the mover
+			for (int l = 0; l < lanes; l++) {
+				if (b.mover.hits[l] == 20) {
+					b.finish(l, begin, out);
+				}
+			}
+		}
+	}
+}
+
+}
+
+void play_easy_games_scalar(uint64_t seed, uint64_t begin, uint64_t end, GameOutcome* out) {
+	play<false>(seed, begin, end, out);
+}
+
+__attribute__((target("avx2,bmi2")))
+void play_easy_games_avx2(uint64_t seed, uint64_t begin, uint64_t end, GameOutcome* out) {
+	play<true>(seed, begin, end, out);
+}
+
+void play_easy_games(uint64_t seed, uint64_t begin, uint64_t end, GameOutcome* out) {
+	static const bool bmi2 = __builtin_cpu_supports("bmi2");
+	if (has_avx2() && bmi2) {
+		play_easy_games_avx2(seed, begin, end, out);
+	} else {
+		play_easy_games_scalar(seed, begin, end, out);
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+
+// Easy against easy, many games side by side. The easy bot never learns
+// anything from the results except which cells it has shot, so a game is
+// just both players drawing unshot cells at random; the engine keeps 16
+// games in the lanes of a struct of arrays and advances them all with one
+// shot per step, a finished game's lane takes the next game.
+//
+// Game i is the same game as the tournament plays with
+// play_match<EasyPlayer, EasyPlayer>: bot 1 and bot 2 are seeded with
+// stream_seed(seed, 2 * i) and stream_seed(seed, 2 * i + 1), in odd games
+// bot 2 shoots first.
+
+struct GameOutcome {
+	uint8_t winner; // 1 or 2, the bot, not the seat
+	uint16_t shots;
+};
+
+// plays games [begin, end), the outcome of game i goes to out[i - begin];
+// picks the AVX2 version when the CPU has it
+void play_easy_games(uint64_t seed, uint64_t begin, uint64_t end, GameOutcome* out);
+
+void play_easy_games_scalar(uint64_t seed, uint64_t begin, uint64_t end, GameOutcome* out);
+
+void play_easy_games_avx2(uint64_t seed, uint64_t begin, uint64_t end, GameOutcome* out);
@@ -0,0 +1,307 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <memory>
+#include <ncurses.h>
+#include <vector>
+#include "batch.h"
+#include "bots.h"
+#include "menu.h"
+#include "placement.h"
+#include "render.h"
+#include "replay.h"
+#include "sim.h"
+
+// Benchmarks of the game core. Positions are built from fixed seeds, so
+// runs are comparable between changes:
+//   ./battleship-bench --benchmark_out=bench.json --benchmark_out_format=json
+
+namespace {
+
+const char* bot_names[] = {"easy", "middle", "hard", "mc"};
+
+void BM_RandomFleet(benchmark::State &state) {
+	Rng rng(1);
+	Bitboard ships[fleet_size];
+	for (auto _ : state) {
+		random_fleet(rng, ships);
+		benchmark::DoNotOptimize(ships);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RandomFleet);
+
+void BM_ArrangeShips(benchmark::State &state) {
+	EasyPlayer bot(1);
+	for (auto _ : state) {
+		bot.arrange_ships();
+		benchmark::DoNotOptimize(bot.field_m.ships);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ArrangeShips);
+
+const Heatmap &middle_heatmap() {
+	static const Heatmap heat = [] {
+		Heatmap h;
+		measure_heatmap("middle", 1, 500, 1, h);
+		return h;
+	}();
+	return heat;
+}
+
+void BM_ScoreLayouts(benchmark::State &state) {
+	Rng rng(1);
+	std::vector<Bitboard> layouts(4096);
+	Bitboard ships[fleet_size];
+	for (Bitboard &layout : layouts) {
+		random_fleet(rng, ships);
+		for (const Bitboard &ship : ships) {
+			layout |= ship;
+		}
+	}
+	std::vector<int> scores(layouts.size());
+	const Heatmap &heat = middle_heatmap();
+	for (auto _ : state) {
+		score_layouts(heat, layouts.data(), layouts.size(), scores.data());
+		benchmark::DoNotOptimize(scores.data());
+	}
+	state.SetItemsProcessed(state.iterations() * layouts.size());
+}
+BENCHMARK(BM_ScoreLayouts);
+
+// candidates per arrangement
+void BM_ArrangeAgainst(benchmark::State &state) {
+	Rng rng(1);
+	Bitboard ships[fleet_size];
+	const Heatmap &heat = middle_heatmap();
+	for (auto _ : state) {
+		arrange_against(heat, rng, state.range(0), 1, ships);
+		benchmark::DoNotOptimize(ships);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ArrangeAgainst)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+// a bot that has made the given number of shots of a game against a fixed
+// fleet, with the results it got
+std::unique_ptr<AbstractPlayer> bot_after(const char* name, int shots) {
+	std::unique_ptr<AbstractPlayer> bot = make_bot(name, 7);
+	EasyPlayer target(3);
+	bot->arrange_ships();
+	target.arrange_ships();
+	for (int i = 0; i < shots; i++) {
+		Coord shot = bot->take_shot();
+		ShotRes res = target.get_shot(shot);
+		bot->get_res(res, shot);
+		if (res == ShotRes::game_over) {
+			break;
+		}
+	}
+	return bot;
+}
+
+// take_shot doesn't change what the bot knows, only its random state
+void BM_TakeShot(benchmark::State &state) {
+	const char* name = bot_names[state.range(0)];
+	std::unique_ptr<AbstractPlayer> bot = bot_after(name, state.range(1));
+	state.SetLabel(name);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(bot->take_shot());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TakeShot)->ArgsProduct({{0, 1, 2}, {0, 20, 50}});
+BENCHMARK(BM_TakeShot)->ArgsProduct({{3}, {0, 20, 50}})->Unit(benchmark::kMillisecond);
+
+// the shots of a recorded easy game, on both fields
+struct GameFixture {
+	Replay replay;
+	std::vector<uint8_t> encoded;
+
+	GameFixture() {
+		EasyPlayer player1(11);
+		EasyPlayer player2(12);
+		MatchResult res = run_match(player1, player2);
+		encode_record(player1.field_m, player2.field_m, res.log, encoded);
+		replay.load(GameRecord{encoded.data()});
+	}
+};
+
+// resolving shots on the own field, as get_shot does
+void BM_Shoot(benchmark::State &state) {
+	GameFixture game;
+	Board fields[2];
+	for (auto _ : state) {
+		game.replay.seek(0);
+		fields[0] = game.replay.field(1);
+		fields[1] = game.replay.field(2);
+		for (int i = 0; i < game.replay.shots(); i++) {
+			Turn turn = game.replay.shot(i);
+			benchmark::DoNotOptimize(fields[2 - turn.player].shoot(turn.shot));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * game.replay.shots());
+}
+BENCHMARK(BM_Shoot);
+
+// recording the results on the view of the opponent's field and marking
+// the halo of sunk ships, as get_res does
+void BM_RecordSunk(benchmark::State &state) {
+	GameFixture game;
+	Board views[2];
+	for (auto _ : state) {
+		views[0].clear();
+		views[1].clear();
+		for (int i = 0; i < game.replay.shots(); i++) {
+			Turn turn = game.replay.shot(i);
+			Board &view = views[turn.player - 1];
+			view.record(turn.res, turn.shot);
+			if (turn.res == ShotRes::sank || turn.res == ShotRes::game_over) {
+				view.mark_sunk(turn.shot);
+			}
+		}
+		benchmark::DoNotOptimize(views);
+	}
+	state.SetItemsProcessed(state.iterations() * game.replay.shots());
+}
+BENCHMARK(BM_RecordSunk);
+
+void BM_Game(benchmark::State &state) {
+	const char* name1 = bot_names[state.range(0)];
+	const char* name2 = bot_names[state.range(1)];
+	state.SetLabel(std::string(name1) + ":" + name2);
+	uint64_t seed = 0;
+	for (auto _ : state) {
+		std::unique_ptr<AbstractPlayer> bot1 = make_bot(name1, seed++);
+		std::unique_ptr<AbstractPlayer> bot2 = make_bot(name2, seed++);
+		benchmark::DoNotOptimize(run_match(*bot1, *bot2, false).shots);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Game)->Args({0, 0})->Args({1, 0})->Args({1, 1})->Args({2, 1})->Args({2, 2});
+
+// the same with the bots' types known to play_match
+template <typename Bot1, typename Bot2>
+void BM_GameDirect(benchmark::State &state) {
+	uint64_t seed = 0;
+	for (auto _ : state) {
+		Bot1 bot1(seed++);
+		Bot2 bot2(seed++);
+		benchmark::DoNotOptimize(play_match(bot1, bot2, false).shots);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_GameDirect, EasyPlayer, EasyPlayer);
+BENCHMARK_TEMPLATE(BM_GameDirect, MiddlePlayer, EasyPlayer);
+BENCHMARK_TEMPLATE(BM_GameDirect, MiddlePlayer, MiddlePlayer);
+
+// hard against middle with the endgame solved exactly from the given
+// number of layouts on; every game meets new positions, the table of
+// solved ones helps only within a game
+void BM_GameEndgame(benchmark::State &state) {
+	uint64_t seed = 0;
+	for (auto _ : state) {
+		HardPlayer bot1(seed++);
+		MiddlePlayer bot2(seed++);
+		bot1.endgame.max_layouts = state.range(0);
+		benchmark::DoNotOptimize(play_match(bot1, bot2, false).shots);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GameEndgame)->Arg(10)->Arg(30)->Unit(benchmark::kMillisecond);
+
+// easy against easy on the batched engine, in blocks of the given size
+void BM_EasyBatch(benchmark::State &state) {
+	uint64_t n = state.range(0);
+	std::vector<GameOutcome> out(n);
+	uint64_t next = 0;
+	for (auto _ : state) {
+		play_easy_games(1, next, next + n, out.data());
+		benchmark::DoNotOptimize(out.data());
+		next += n;
+	}
+	state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_EasyBatch)->Arg(256)->Arg(4096);
+
+// ncurses writing to /dev/null, the output is produced but goes nowhere
+struct NullScreen {
+	FILE* out;
+	FILE* in;
+	SCREEN* screen;
+
+	NullScreen() {
+		out = fopen("/dev/null", "w");
+		in = fopen("/dev/null", "r");
+		screen = newterm("xterm", out, in);
+		start_color();
+		for (short pair = 1; pair < 15; pair++) {
+			init_pair(pair, COLOR_WHITE, pair % 8);
+		}
+	}
+
+	~NullScreen() {
+		endwin();
+		delscreen(screen);
+		fclose(out);
+		fclose(in);
+	}
+};
+
+// a cursor moving over the opponent's field, only two cells change
+void BM_RenderCursor(benchmark::State &state) {
+	NullScreen null;
+	WINDOW* win = newwin(14, 25, 0, 0);
+	BoardView view(win);
+	GameFixture game;
+	game.replay.seek(game.replay.shots() / 2);
+
+	short colors[100];
+	board_colors(game.replay.field(2), true, colors);
+	int cursor = 0;
+	for (auto _ : state) {
+		short under = colors[cursor];
+		colors[cursor] = 6;
+		view.draw(colors);
+		doupdate();
+		colors[cursor] = under;
+		cursor = (cursor + 1) % 100;
+	}
+	state.SetItemsProcessed(state.iterations());
+	delwin(win);
+}
+BENCHMARK(BM_RenderCursor);
+
+// the whole field painted again, as after a window is cleared
+void BM_RenderField(benchmark::State &state) {
+	NullScreen null;
+	WINDOW* win = newwin(14, 25, 0, 0);
+	BoardView view(win);
+	GameFixture game;
+	game.replay.seek(game.replay.shots() / 2);
+
+	short colors[100];
+	board_colors(game.replay.field(2), true, colors);
+	for (auto _ : state) {
+		view.invalidate();
+		view.draw(colors);
+		doupdate();
+	}
+	state.SetItemsProcessed(state.iterations());
+	delwin(win);
+}
+BENCHMARK(BM_RenderField);
+
+// a message box: the screen cleared, the title and a framed window drawn
+void BM_RenderMenu(benchmark::State &state) {
+	NullScreen null;
+	for (auto _ : state) {
+		print_message("Game code: 12345, waiting for the opponent");
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RenderMenu);
+
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,82 @@
+#include "board.h"
+
+void Board::clear() {
+	*this = Board();
+}
+
+void Board::place(Bitboard ship) {
+	ships |= ship;
+	halo |= ::halo(ship);
+	fleet[ship_num] = ship;
+	ship_num++;
+	alive_ships_num++;
+}
+
+ShotRes Board::shoot(Coord xy) {
+	Bitboard shot = Bitboard::cell(xy.x, xy.y);
+
+	if ((shot & ships).empty()) {
+		misses |= shot;
+		return ShotRes::miss;
+	}
+	if ((shot & hits).any()) {
+		return ShotRes::hit;
+	}
+
+	hits |= shot;
+
+	for (int i = 0; i < ship_num; i++) {
+		if ((fleet[i] & shot).any()) {
+			if ((fleet[i] & ~hits).any()) {
+				return ShotRes::hit;
+			}
+			sunk |= fleet[i];
+			alive_ships_num--;
+			break;
+		}
+	}
+
+	if (alive_ships_num > 0) {
+		return ShotRes::sank;
+	} else {
+		return ShotRes::game_over;
+	}
+}
+
+void Board::record(ShotRes res, Coord xy) {
+	if (res == ShotRes::miss) {
+		misses.set(xy.x, xy.y);
+	} else {
+		hits.set(xy.x, xy.y);
+	}
+}
+
+Bitboard Board::mark_sunk(Coord xy) {
+	// ships are straight, so growing along hit cells stops after at most 3 steps
+	Bitboard ship = Bitboard::cell(xy.x, xy.y);
+	Bitboard grown = dilate4(ship) & hits;
+	while (grown != ship) {
+		ship = grown;
+		grown = dilate4(ship) & hits;
+	}
+
+	sunk |= ship;
+	halo |= ::halo(ship);
+	return ship;
+}
+
+Cell Board::cell(int x, int y) const {
+	int i = y * 10 + x;
+	if (sunk.test(i)) {
+		return Cell::sunk;
+	} else if (hits.test(i)) {
+		return Cell::hit;
+	} else if (misses.test(i)) {
+		return Cell::miss;
+	} else if (ships.test(i)) {
+		return Cell::ship;
+	} else if (halo.test(i)) {
+		return Cell::halo;
+	}
+	return Cell::empty;
+}
@@ -0,0 +1,255 @@
+#pragma once
+#include <cstdint>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+enum class ShotRes {
+	hit,
+	miss,
+	sank,
+	game_over
+};
+
+enum class GameRes {
+	win,
+	loss
+};
+
+struct Coord {
+	int x, y;
+};
+
+// 10x10 field packed into 128 bits, cell (x, y) is bit y * 10 + x
+struct Bitboard {
+	uint64_t lo = 0;
+	uint64_t hi = 0; // bits 64..99, the upper 28 bits are always zero
+
+	static constexpr uint64_t hi_mask = (uint64_t(1) << 36) - 1;
+
+	static constexpr Bitboard bit(int i) {
+		Bitboard b;
+		if (i < 64) {
+			b.lo = uint64_t(1) << i;
+		} else {
+			b.hi = uint64_t(1) << (i - 64);
+		}
+		return b;
+	}
+
+	static constexpr Bitboard cell(int x, int y) {
+		return bit(y * 10 + x);
+	}
+
+	static constexpr Bitboard full() {
+		Bitboard b;
+		b.lo = ~uint64_t(0);
+		b.hi = hi_mask;
+		return b;
+	}
+
+	// cells with the given x
+	static constexpr Bitboard column(int x) {
+		Bitboard b;
+		for (int y = 0; y < 10; y++) {
+			b |= cell(x, y);
+		}
+		return b;
+	}
+
+	constexpr bool test(int i) const {
+		return i < 64 ? (lo >> i) & 1 : (hi >> (i - 64)) & 1;
+	}
+
+	constexpr bool test(int x, int y) const {
+		return test(y * 10 + x);
+	}
+
+	constexpr void set(int x, int y) {
+		*this |= cell(x, y);
+	}
+
+	constexpr bool empty() const {
+		return (lo | hi) == 0;
+	}
+
+	constexpr bool any() const {
+		return !empty();
+	}
+
+	int count() const {
+		return __builtin_popcountll(lo) + __builtin_popcountll(hi);
+	}
+
+	// index of the lowest set bit, the board must not be empty
+	int lowest() const {
+		return lo ? __builtin_ctzll(lo) : 64 + __builtin_ctzll(hi);
+	}
+
+	int pop() {
+		int i = lowest();
+		*this &= ~bit(i);
+		return i;
+	}
+
+	// index of the n-th (from zero) set bit, n must be less than count()
+	int nth(int n) const {
+		uint64_t w = lo;
+		int base = 0;
+		int c = __builtin_popcountll(lo);
+		if (n >= c) {
+			n -= c;
+			w = hi;
+			base = 64;
+		}
+#ifdef __BMI2__
+		return base + __builtin_ctzll(_pdep_u64(uint64_t(1) << n, w));
+#else
+		for (; n > 0; n--) {
+			w &= w - 1;
+		}
+		return base + __builtin_ctzll(w);
+#endif
+	}
+
+	constexpr Bitboard shl(int n) const {
+		Bitboard b;
+		b.lo = lo << n;
+		b.hi = ((hi << n) | (lo >> (64 - n))) & hi_mask;
+		return b;
+	}
+
+	constexpr Bitboard shr(int n) const {
+		Bitboard b;
+		b.lo = (lo >> n) | (hi << (64 - n));
+		b.hi = hi >> n;
+		return b;
+	}
+
+	constexpr Bitboard operator~() const {
+		Bitboard b;
+		b.lo = ~lo;
+		b.hi = ~hi & hi_mask;
+		return b;
+	}
+
+	constexpr Bitboard& operator&=(Bitboard o) {
+		lo &= o.lo;
+		hi &= o.hi;
+		return *this;
+	}
+
+	constexpr Bitboard& operator|=(Bitboard o) {
+		lo |= o.lo;
+		hi |= o.hi;
+		return *this;
+	}
+
+	constexpr Bitboard& operator^=(Bitboard o) {
+		lo ^= o.lo;
+		hi ^= o.hi;
+		return *this;
+	}
+
+	friend constexpr Bitboard operator&(Bitboard a, Bitboard b) {
+		return a &= b;
+	}
+
+	friend constexpr Bitboard operator|(Bitboard a, Bitboard b) {
+		return a |= b;
+	}
+
+	friend constexpr Bitboard operator^(Bitboard a, Bitboard b) {
+		return a ^= b;
+	}
+
+	friend constexpr bool operator==(Bitboard a, Bitboard b) {
+		return a.lo == b.lo && a.hi == b.hi;
+	}
+
+	friend constexpr bool operator!=(Bitboard a, Bitboard b) {
+		return !(a == b);
+	}
+};
+
+constexpr Bitboard not_left = ~Bitboard::column(0);
+constexpr Bitboard not_right = ~Bitboard::column(9);
+
+// b spread by one cell left and right
+constexpr Bitboard dilate_x(Bitboard b) {
+	return b | (b.shl(1) & not_left) | (b.shr(1) & not_right);
+}
+
+// b spread by one cell up and down
+constexpr Bitboard dilate_y(Bitboard b) {
+	return b | b.shl(10) | b.shr(10);
+}
+
+// b together with its 4 side neighbours
+constexpr Bitboard dilate4(Bitboard b) {
+	return dilate_x(b) | dilate_y(b);
+}
+
+// the 8-neighbour border around b, without b itself
+constexpr Bitboard halo(Bitboard b) {
+	return dilate_y(dilate_x(b)) & ~b;
+}
+
+// vertical = 1, horizontal = 0
+constexpr Bitboard ship_mask(int ship_len, int x, int y, int orientation) {
+	Bitboard b;
+	for (int i = 0; i < ship_len; i++) {
+		b |= Bitboard::cell(x + i * (1 - orientation), y + i * orientation);
+	}
+	return b;
+}
+
+enum class Cell {
+	empty,
+	ship,
+	halo,
+	miss,
+	hit,
+	sunk
+};
+
+// state of one field; the same type serves a player's own field and
+// the view of the opponent's field (where ships and fleet stay empty)
+struct Board {
+	Bitboard ships;
+	Bitboard halo; // cells that can't hold a ship: around placed ships or around sunk ones
+	Bitboard misses;
+	Bitboard hits;
+	Bitboard sunk;
+	Bitboard fleet[10];
+	int ship_num = 0;
+	int alive_ships_num = 0;
+
+	void clear();
+
+	bool can_place(Bitboard ship) const {
+		return (ship & (ships | halo)).empty();
+	}
+
+	void place(Bitboard ship);
+
+	// resolves the opponent's shot at this (own) field
+	ShotRes shoot(Coord xy);
+
+	// records the result of own shot on the view of the opponent's field
+	void record(ShotRes res, Coord xy);
+
+	// marks the ship through xy as sunk and its border as halo, returns the ship
+	Bitboard mark_sunk(Coord xy);
+
+	Bitboard shot() const {
+		return misses | hits;
+	}
+
+	// cells that may still hold a ship and haven't been shot
+	Bitboard unknown() const {
+		return ~(misses | hits | halo);
+	}
+
+	Cell cell(int x, int y) const;
+};
@@ -0,0 +1,249 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bots.h"
+#include "metrics.h"
+#include "net.h"
+#include "sim.h"
+
+// A bot playing on the server, for trying the server out over loopback:
+//   create          hosts a match and prints its code
+//   join CODE       joins a match
+//   watch CODE      prints the moves of a match and both fields at its end
+//   load N PAIRS [S]  plays N matches with PAIRS pairs of bots at a time and
+//                   checks that both sides of every match agree on the winner
+//                   and accept each other's revealed layouts; S spectators
+//                   follow every match and check what they saw
+
+namespace {
+
+void usage() {
+	fprintf(stderr,
+		"usage: battleship-bot [-s host:port] [-b bot] [-m metrics] create | join CODE | watch CODE"
+		" | load GAMES PAIRS [SPECTATORS]\n"
+		"-m writes the latency of the players' calls to the file, as JSON if it ends with .json\n");
+}
+
+// follows the match until it ends, returns the winner (0 or 1, 2 if abandoned)
+int follow(Link &link, uint16_t code, MatchView &view, bool verbose) {
+	static const char* res_names[] = {"hit", "miss", "sank", "game over"};
+
+	link.watch_game(code);
+	while (true) {
+		Frame frame = link.recv();
+		view.apply(frame);
+		if (frame.type == FrameType::move && verbose) {
+			Coord xy = frame_coord(frame);
+			printf("player %d: %c%d %s\n", frame.value + 1, 'A' + xy.x, xy.y + 1, res_names[int(frame.res)]);
+		} else if (frame.type == FrameType::over) {
+			return frame.cell;
+		}
+	}
+}
+
+void print_fields(const MatchView &view) {
+	// empty, ship, halo, miss, hit, sunk
+	static const char marks[] = ".#-oxX";
+	for (int y = 0; y < 10; y++) {
+		for (int field = 0; field < 2; field++) {
+			printf(field == 0 ? "" : "   ");
+			for (int x = 0; x < 10; x++) {
+				putchar(marks[int(view.fields[field].cell(x, y))]);
+			}
+		}
+		putchar('\n');
+	}
+}
+
+// 1 if the side that shot first (the creator) won, 2 otherwise;
+// verified tells whether the opponent's layout checked out
+int play(AbstractPlayer &bot, Link &link, bool first, bool &verified) {
+	NetworkPlayer remote(link, bot);
+	int winner = first ? run_match(bot, remote, false).winner : run_match(remote, bot, false).winner;
+	verified = remote.opponent_verified();
+	return winner;
+}
+
+// a spectator's view of a finished match: the loser's ships are all sunk
+// and the winner's field is a legal fleet's worth of ships
+bool view_ok(const MatchView &view, int winner) {
+	if (winner > 1) {
+		return false;
+	}
+	const Board &lost = view.fields[1 - winner];
+	const Board &won = view.fields[winner];
+	return lost.ships == lost.sunk && lost.ships.count() == 20 && won.ships.count() == 20
+		&& (won.sunk & ~won.ships).empty();
+}
+
+int load(const std::string &host, int port, const std::string &bot_name, int games, int pairs,
+		int spectators) {
+	std::atomic<int> next{0};
+	std::atomic<int> played{0};
+	std::atomic<int> mismatches{0};
+	std::atomic<int> unverified{0};
+	std::atomic<int> bad_views{0};
+	std::atomic<int> failures{0};
+
+	auto pair_loop = [&](int pair) {
+		for (int game = next++; game < games; game = next++) {
+			try {
+				bool joiner_verified = false;
+				std::future<uint16_t> code_future;
+				std::future<int> joiner;
+				// destroyed before joiner, whose destructor waits for the
+				// joining thread: if anything below throws before the code is
+				// set, the thread gets a broken promise instead of waiting forever
+				std::promise<uint16_t> code;
+				code_future = code.get_future();
+				joiner = std::async(std::launch::async, [&] {
+					Link link(host, port);
+					link.join_game(code_future.get());
+					std::unique_ptr<AbstractPlayer> bot = make_bot(bot_name, 2 * game + 1);
+					return play(*bot, link, link.wait_start(), joiner_verified);
+				});
+
+				Link link(host, port);
+				uint16_t match_code = link.create_game();
+				std::vector<std::future<bool>> watchers;
+				for (int i = 0; i < spectators; i++) {
+					watchers.push_back(std::async(std::launch::async, [&] {
+						Link watcher(host, port);
+						MatchView view;
+						return view_ok(view, follow(watcher, match_code, view, false));
+					}));
+				}
+				code.set_value(match_code);
+				std::unique_ptr<AbstractPlayer> bot = make_bot(bot_name, 2 * game);
+				bool creator_verified;
+				int creator_view = play(*bot, link, link.wait_start(), creator_verified);
+
+				if (joiner.get() != creator_view) {
+					mismatches++;
+				}
+				if (!creator_verified || !joiner_verified) {
+					unverified++;
+				}
+				for (std::future<bool> &watcher : watchers) {
+					if (!watcher.get()) {
+						bad_views++;
+					}
+				}
+				played++;
+			} catch (const std::exception &e) {
+				fprintf(stderr, "pair %d: %s\n", pair, e.what());
+				failures++;
+				return;
+			}
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (int i = 0; i < pairs; i++) {
+		threads.emplace_back(pair_loop, i);
+	}
+	for (std::thread &t : threads) {
+		t.join();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	printf("%d matches in %.2fs (%.0f matches/s), %d disagreements, %d unverified, %d bad spectator views,"
+		" %d failed pairs\n", played.load(), elapsed.count(), played / elapsed.count(), mismatches.load(),
+		unverified.load(), bad_views.load(), failures.load());
+	return mismatches == 0 && unverified == 0 && bad_views == 0 && failures == 0 ? 0 : 1;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	std::string host;
+	int port;
+	server_address(host, port);
+	std::string bot_name = "middle";
+	const char* metrics_path = nullptr;
+
+	int i = 1;
+	for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+		if (strcmp(argv[i], "-s") == 0) {
+			const char* colon = strrchr(argv[i + 1], ':');
+			if (colon == nullptr) {
+				host = argv[i + 1];
+			} else {
+				host = std::string(argv[i + 1], colon - argv[i + 1]);
+				port = atoi(colon + 1);
+			}
+		} else if (strcmp(argv[i], "-b") == 0) {
+			bot_name = argv[i + 1];
+		} else if (strcmp(argv[i], "-m") == 0) {
+			metrics_path = argv[i + 1];
+			enable_metrics();
+		} else {
+			usage();
+			return 1;
+		}
+	}
+
+	if (!make_bot(bot_name, 0) || i >= argc) {
+		usage();
+		return 1;
+	}
+
+	std::string mode = argv[i];
+	int status = 0;
+	try {
+		if (mode == "create") {
+			Link link(host, port);
+			printf("code %u\n", link.create_game());
+			fflush(stdout);
+			std::unique_ptr<AbstractPlayer> bot = make_bot(bot_name, 1);
+			bool first = link.wait_start();
+			bool verified;
+			printf(play(*bot, link, first, verified) == 1 ? "won\n" : "lost\n");
+			if (!verified) {
+				printf("the opponent's layout doesn't match its answers\n");
+			}
+		} else if (mode == "join" && i + 1 < argc) {
+			Link link(host, port);
+			link.join_game(uint16_t(atoi(argv[i + 1])));
+			std::unique_ptr<AbstractPlayer> bot = make_bot(bot_name, 2);
+			bool first = link.wait_start();
+			bool verified;
+			printf(play(*bot, link, first, verified) == 2 ? "won\n" : "lost\n");
+			if (!verified) {
+				printf("the opponent's layout doesn't match its answers\n");
+			}
+		} else if (mode == "watch" && i + 1 < argc) {
+			Link link(host, port);
+			MatchView view;
+			int winner = follow(link, uint16_t(atoi(argv[i + 1])), view, true);
+			print_fields(view);
+			if (winner < 2) {
+				printf("player %d won\n", winner + 1);
+			} else {
+				printf("the match was abandoned\n");
+			}
+		} else if (mode == "load" && i + 2 < argc) {
+			int spectators = i + 3 < argc ? atoi(argv[i + 3]) : 0;
+			status = load(host, port, bot_name, atoi(argv[i + 1]), atoi(argv[i + 2]), spectators);
+		} else {
+			usage();
+			return 1;
+		}
+	} catch (const NetworkError &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+
+	if (metrics_path != nullptr && !save_metrics(metrics_path)) {
+		fprintf(stderr, "can't write the metrics to %s\n", metrics_path);
+		return 1;
+	}
+	return status;
+}
@@ -0,0 +1,344 @@
+#include <cstring>
+#include <random>
+#include "accumulate.h"
+#include "bots.h"
+#include "placement.h"
+
+namespace {
+
+// the cell with the highest score, ties are broken at random
+template <typename Score>
+int best_cell(const Score* score, Bitboard cells, Rng &rng) {
+	int best = -1;
+	int ties = 0;
+	while (cells.any()) {
+		int i = cells.pop();
+		if (best == -1 || score[i] > score[best]) {
+			best = i;
+			ties = 1;
+		} else if (score[i] == score[best] && rng.below(++ties) == 0) {
+			best = i;
+		}
+	}
+	return best;
+}
+
+// for every cell the positions of the remaining ships through it that are
+// consistent with the field; while a ship is hit but not sunk only the
+// positions through its hits count, once per hit they cover
+void count_positions(const Board &other, const int* remaining, uint32_t* density) {
+	Bitboard blocked = other.misses | other.halo | other.sunk;
+	Bitboard open_hits = other.hits & ~other.sunk;
+	Bitboard free = other.unknown();
+
+	for (int ship_len = 1; ship_len < 5; ship_len++) {
+		if (remaining[ship_len] == 0) {
+			continue;
+		}
+		for (const Placement &p : placements(ship_len)) {
+			// a ship can't lie on a miss and can't touch another ship's hit
+			if ((p.ship & blocked).any() || (p.halo & open_hits).any()) {
+				continue;
+			}
+			int weight = remaining[ship_len];
+			if (open_hits.any()) {
+				int covered = (p.ship & open_hits).count();
+				if (covered == 0) {
+					continue;
+				}
+				weight *= covered;
+			}
+			for (Bitboard cells = p.ship & free; cells.any(); ) {
+				density[cells.pop()] += weight;
+			}
+		}
+	}
+}
+
+}
+
+BotPlayer::BotPlayer() : rng(std::random_device()()) {}
+
+void BotPlayer::arrange_ships() {
+	field_m.clear();
+	other_field_m.clear();
+
+	Bitboard ships[fleet_size];
+	if (avoid != nullptr) {
+		arrange_against(*avoid, rng, avoid_candidates, 1, ships);
+	} else {
+		random_fleet(rng, ships);
+	}
+	for (const Bitboard &ship : ships) {
+		field_m.place(ship);
+	}
+}
+
+ShotRes BotPlayer::get_shot(Coord xy) {
+	return field_m.shoot(xy);
+}
+
+Coord EasyPlayer::take_shot() {
+	Bitboard free = other_field_m.unknown();
+	int i = free.nth(rng.below(free.count()));
+	return Coord{i % 10, i / 10};
+}
+
+void EasyPlayer::get_res(ShotRes res, Coord shot) {
+	other_field_m.record(res, shot);
+}
+
+Coord MiddlePlayer::take_shot() {
+	// cells with even x + y, every ship longer than one cell covers one of them
+	static const Bitboard parity = [] {
+		Bitboard b;
+		for (int i = 0; i < 100; i += 2) {
+			b |= Bitboard::bit(i + (i / 10) % 2);
+		}
+		return b;
+	}();
+
+	const Board &other = other_field_m;
+	Bitboard free = other.unknown();
+	Bitboard open_hits = other.hits & ~other.sunk;
+	Bitboard targets;
+
+	if (open_hits.count() > 1) {
+		// the hits lie on one line, continue it at either end
+		bool horizontal = (open_hits & open_hits.shl(1) & not_left).any();
+		targets = (horizontal ? dilate_x(open_hits) : dilate_y(open_hits)) & free;
+	} else if (open_hits.any()) {
+		targets = dilate4(open_hits) & free;
+	}
+
+	if (targets.empty()) {
+		targets = free & parity;
+	}
+	if (targets.empty()) {
+		targets = free;
+	}
+
+	int i = targets.nth(rng.below(targets.count()));
+	return Coord{i % 10, i / 10};
+}
+
+void MiddlePlayer::get_res(ShotRes res, Coord shot) {
+	other_field_m.record(res, shot);
+	if (res == ShotRes::sank) {
+		other_field_m.mark_sunk(shot);
+	}
+}
+
+void HardPlayer::arrange_ships() {
+	BotPlayer::arrange_ships();
+	key = cache_salt();
+	for (int ship_len = 1; ship_len < 5; ship_len++) {
+		remaining[ship_len] = 5 - ship_len;
+		key ^= zobrist_fleet(ship_len, remaining[ship_len]);
+	}
+}
+
+Coord HardPlayer::take_shot() {
+	if (endgame.max_layouts > 0) {
+		EndgameResult solved = solve_endgame(other_field_m, remaining, endgame);
+		if (solved.cell != -1) {
+			return Coord{solved.cell % 10, solved.cell / 10};
+		}
+	}
+
+	bool cacheable = cache != nullptr && (other_field_m.shot().count() <= opening_shots
+		|| other_field_m.unknown().count() <= endgame_cells);
+
+	int cell;
+	if (cacheable && cache->lookup(key, cell)) {
+		return Coord{cell % 10, cell / 10};
+	}
+
+	Coord shot = choose_shot();
+	if (cacheable) {
+		cache->store(key, shot.y * 10 + shot.x);
+	}
+	return shot;
+}
+
+Coord HardPlayer::choose_shot() {
+	uint32_t density[100] = {};
+	count_positions(other_field_m, remaining, density);
+
+	int best = best_cell(density, other_field_m.unknown(), rng);
+	return Coord{best % 10, best / 10};
+}
+
+void HardPlayer::get_res(ShotRes res, Coord shot) {
+	other_field_m.record(res, shot);
+
+	int cell = shot.y * 10 + shot.x;
+	key ^= zobrist(res == ShotRes::miss ? CellKey::miss : CellKey::hit, cell);
+
+	if (res == ShotRes::sank) {
+		Bitboard ship = other_field_m.mark_sunk(shot);
+		int ship_len = ship.count();
+		key ^= zobrist_fleet(ship_len, remaining[ship_len]);
+		remaining[ship_len]--;
+		key ^= zobrist_fleet(ship_len, remaining[ship_len]);
+		while (ship.any()) {
+			cell = ship.pop();
+			key ^= zobrist(CellKey::hit, cell) ^ zobrist(CellKey::sunk, cell);
+		}
+	}
+}
+
+Coord MonteCarloPlayer::choose_shot() {
+	const Board &other = other_field_m;
+	Bitboard blocked = other.misses | other.halo | other.sunk;
+	Bitboard open_hits = other.hits & ~other.sunk;
+
+	int lens[fleet_size];
+	int count = 0;
+	for (int ship_len = 4; ship_len > 0; ship_len--) {
+		for (int i = 0; i < remaining[ship_len]; i++) {
+			lens[count++] = ship_len;
+		}
+	}
+
+	// while a ship is hit, the first sampled ship goes through its first hit
+	// cell, otherwise almost no sample would cover the hits
+	std::vector<const Placement*> through;
+	std::vector<int> through_len;
+	if (open_hits.any()) {
+		Bitboard target = Bitboard::bit(open_hits.lowest());
+		for (int ship_len = 1; ship_len < 5; ship_len++) {
+			if (remaining[ship_len] == 0) {
+				continue;
+			}
+			for (const Placement &p : placements(ship_len)) {
+				if ((p.ship & target).any() && (p.ship & blocked).empty()
+						&& (p.halo & open_hits).empty()) {
+					through.push_back(&p);
+					through_len.push_back(ship_len);
+				}
+			}
+		}
+	}
+
+	layouts.resize(samples);
+	Bitboard ships[fleet_size];
+	int n = 0;
+	for (int attempt = 0; attempt < samples * 4 && n < samples; attempt++) {
+		Bitboard layout;
+		if (open_hits.any()) {
+			if (through.empty()) {
+				break;
+			}
+			int k = rng.below(through.size());
+			int rest[fleet_size];
+			int rest_num = 0;
+			bool skipped = false;
+			for (int i = 0; i < count; i++) {
+				if (!skipped && lens[i] == through_len[k]) {
+					skipped = true;
+				} else {
+					rest[rest_num++] = lens[i];
+				}
+			}
+			if (!sample_ships(rng, blocked | through[k]->ship | through[k]->halo, rest, rest_num, ships)) {
+				continue;
+			}
+			layout = through[k]->ship;
+			for (int i = 0; i < rest_num; i++) {
+				layout |= ships[i];
+			}
+			if ((open_hits & ~layout).any()) {
+				continue;
+			}
+		} else {
+			if (!sample_ships(rng, blocked, lens, count, ships)) {
+				continue;
+			}
+			for (int i = 0; i < count; i++) {
+				layout |= ships[i];
+			}
+		}
+		layouts[n++] = layout;
+	}
+
+	if (n == 0) {
+		return HardPlayer::choose_shot();
+	}
+
+	uint32_t frequency[100] = {};
+	accumulate(layouts.data(), n, frequency);
+	int best = best_cell(frequency, other.unknown(), rng);
+	return Coord{best % 10, best / 10};
+}
+
+Coord WeightedPlayer::choose_shot() {
+	const Board &other = other_field_m;
+	Bitboard free = other.unknown();
+	Bitboard near_hits = dilate4(other.hits & ~other.sunk) & free;
+
+	uint32_t density[100] = {};
+	count_positions(other, remaining, density);
+
+	// cells no ship can cover are left alone whatever the weights say
+	Bitboard live;
+	uint32_t densest = 0;
+	for (Bitboard cells = free; cells.any(); ) {
+		int i = cells.pop();
+		if (density[i] != 0) {
+			live |= Bitboard::bit(i);
+			densest = density[i] > densest ? density[i] : densest;
+		}
+	}
+	if (live.empty()) {
+		live = free;
+	}
+
+	double score[100];
+	for (Bitboard cells = live; cells.any(); ) {
+		int i = cells.pop();
+		int x = i % 10;
+		int y = i / 10;
+		score[i] = weights[Feature::density] * (densest == 0 ? 0.0 : double(density[i]) / densest)
+			+ weights[Feature::parity] * ((x + y) % 2 == 0)
+			+ weights[Feature::adjacency] * near_hits.test(i)
+			+ weights[Feature::edge] * (x == 0 || x == 9 || y == 0 || y == 9);
+	}
+
+	int best = best_cell(score, live, rng);
+	return Coord{best % 10, best / 10};
+}
+
+uint64_t WeightedPlayer::cache_salt() const {
+	uint64_t state = 0x7e4d;
+	uint64_t salt = 0;
+	for (double w : weights.w) {
+		uint64_t bits;
+		memcpy(&bits, &w, sizeof bits);
+		state ^= bits;
+		salt = splitmix64(state);
+	}
+	return salt;
+}
+
+std::unique_ptr<AbstractPlayer> make_bot(const std::string &name, uint64_t seed,
+		PositionCache* cache) {
+	if (name == "easy") {
+		return std::make_unique<EasyPlayer>(seed);
+	} else if (name == "middle") {
+		return std::make_unique<MiddlePlayer>(seed);
+	}
+
+	std::unique_ptr<HardPlayer> bot;
+	if (name == "hard") {
+		bot = std::make_unique<HardPlayer>(seed);
+	} else if (name == "mc") {
+		bot = std::make_unique<MonteCarloPlayer>(seed);
+	} else if (name == "tuned") {
+		bot = std::make_unique<WeightedPlayer>(seed);
+	}
+	if (bot) {
+		bot->cache = cache;
+	}
+	return bot;
+}
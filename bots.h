@@ -0,0 +1,169 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "arrange.h"
+#include "cache.h"
+#include "endgame.h"
+#include "player.h"
+#include "rng.h"
+#include "weights.h"
+
+// common part of the computer players: random arrangement of the fleet
+// and answering the opponent's shots
+struct BotPlayer : AbstractPlayer {
+	BotPlayer();
+
+	explicit BotPlayer(uint64_t seed) : rng(seed) {}
+
+	virtual void arrange_ships() override;
+
+	virtual ShotRes get_shot(Coord xy) override;
+
+	virtual void game_res(GameRes) override {}
+
+	// with a heatmap the fleet is the coolest of that many random ones
+	// instead of the first, see arrange_against
+	const Heatmap* avoid = nullptr;
+	int avoid_candidates = 1000;
+
+protected:
+	Rng rng;
+};
+
+// shoots uniformly at random among the cells it hasn't shot yet
+struct EasyPlayer final : BotPlayer {
+	using BotPlayer::BotPlayer;
+
+	virtual const char* name() const override {
+		return "easy";
+	}
+
+	virtual Coord take_shot() override;
+
+	virtual void get_res(ShotRes res, Coord shot) override;
+};
+
+// hunts on a checkerboard until it hits a ship, then follows the line
+// of hits until the ship is sunk; the halo around sunk ships is skipped
+struct MiddlePlayer final : BotPlayer {
+	using BotPlayer::BotPlayer;
+
+	virtual const char* name() const override {
+		return "middle";
+	}
+
+	virtual Coord take_shot() override;
+
+	virtual void get_res(ShotRes res, Coord shot) override;
+};
+
+// for every cell counts the positions of the remaining ships that are
+// consistent with what is known about the field and covers it, then
+// shoots at the cell covered the most; while a ship is hit but not sunk
+// only the positions through its hit cells count
+struct HardPlayer : BotPlayer {
+	using BotPlayer::BotPlayer;
+
+	virtual const char* name() const override {
+		return "hard";
+	}
+
+	virtual void arrange_ships() override;
+
+	// plays the endgame exactly when it's allowed to, otherwise asks the
+	// cache first in the opening and in the endgame
+	virtual Coord take_shot() override;
+
+	virtual void get_res(ShotRes res, Coord shot) override;
+
+	// number of not yet sunk ships by their length
+	int remaining[5];
+
+	PositionCache* cache = nullptr;
+	int opening_shots = 8;
+	int endgame_cells = 16;
+	// the exact solver is off unless max_layouts is set
+	EndgameLimits endgame;
+
+protected:
+	virtual Coord choose_shot();
+
+	// keeps positions of different bots apart in a shared cache
+	virtual uint64_t cache_salt() const {
+		return 0x4a5d;
+	}
+
+	// Zobrist key of other_field_m and remaining, updated on every result
+	uint64_t key;
+};
+
+// samples random arrangements of the remaining fleet that agree with
+// everything seen on the opponent's field and shoots at the cell that
+// holds a ship in most of them; the samples are only as uniform as
+// sample_ships makes them (placement.h)
+struct MonteCarloPlayer final : HardPlayer {
+	explicit MonteCarloPlayer(uint64_t seed, int samples = 10000)
+		: HardPlayer(seed), samples(samples) {}
+
+	virtual const char* name() const override {
+		return "mc";
+	}
+
+	int samples;
+
+protected:
+	virtual Coord choose_shot() override;
+
+	virtual uint64_t cache_salt() const override {
+		return 0x3c41 ^ uint64_t(samples) << 16;
+	}
+
+private:
+	std::vector<Bitboard> layouts;
+};
+
+// hard's count of positions blended with a few simple hints, see Weights;
+// shoots at the unshot cell with the highest weighted sum
+struct WeightedPlayer final : HardPlayer {
+	using HardPlayer::HardPlayer;
+
+	WeightedPlayer(uint64_t seed, const Weights &weights) : HardPlayer(seed), weights(weights) {}
+
+	virtual const char* name() const override {
+		return "tuned";
+	}
+
+	Weights weights;
+
+protected:
+	virtual Coord choose_shot() override;
+
+	virtual uint64_t cache_salt() const override;
+};
+
+// bot by its name ("easy", "middle", "hard", "mc", "tuned"), nullptr if there is no such bot;
+// the bots that can use a position cache get the given one
+std::unique_ptr<AbstractPlayer> make_bot(const std::string &name, uint64_t seed,
+		PositionCache* cache = nullptr);
+
+// calls f with a null pointer of the bot's type, for code that is templated
+// on the concrete bot (see play_match); false if there is no such bot
+template <typename F>
+bool visit_bot(const std::string &name, F &&f) {
+	if (name == "easy") {
+		f(static_cast<EasyPlayer*>(nullptr));
+	} else if (name == "middle") {
+		f(static_cast<MiddlePlayer*>(nullptr));
+	} else if (name == "hard") {
+		f(static_cast<HardPlayer*>(nullptr));
+	} else if (name == "mc") {
+		f(static_cast<MonteCarloPlayer*>(nullptr));
+	} else if (name == "tuned") {
+		f(static_cast<WeightedPlayer*>(nullptr));
+	} else {
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "cache.h"
+#include "rng.h"
+
+namespace {
+
+const char magic[8] = {'B', 'S', 'C', 'A', 'C', 'H', 'E', '2'};
+
+// fixed seed, saved caches stay valid between runs
+struct ZobristTable {
+	uint64_t cells[3][100];
+	uint64_t fleet[5][5];
+
+	ZobristTable() {
+		uint64_t state = 0x5eab4771e5ULL;
+		for (auto &row : cells) {
+			for (uint64_t &w : row) {
+				w = splitmix64(state);
+			}
+		}
+		for (auto &row : fleet) {
+			for (uint64_t &w : row) {
+				w = splitmix64(state);
+			}
+		}
+	}
+};
+
+const ZobristTable zobrist_table;
+
+const uint64_t tag_mask = ~uint64_t(0xff);
+
+}
+
+uint64_t zobrist(CellKey state, int cell) {
+	return zobrist_table.cells[int(state)][cell];
+}
+
+uint64_t zobrist_fleet(int ship_len, int count) {
+	return zobrist_table.fleet[ship_len][count];
+}
+
+PositionCache::PositionCache(size_t entries) {
+	// at least 256 entries, the slot index then keeps the key bits the tag drops
+	size_t size = 256;
+	while (size < entries) {
+		size *= 2;
+	}
+	mask = size - 1;
+	table.reset(new std::atomic<uint64_t>[size]);
+	for (size_t i = 0; i < size; i++) {
+		table[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+bool PositionCache::lookup(uint64_t key, int &cell) const {
+	uint64_t e = table[key & mask].load(std::memory_order_relaxed);
+	if (e == 0 || (e & tag_mask) != (key & tag_mask)) {
+		return false;
+	}
+	cell = int(e & 0xff) - 1;
+	return true;
+}
+
+void PositionCache::store(uint64_t key, int cell) {
+	table[key & mask].store((key & tag_mask) | uint64_t(cell + 1), std::memory_order_relaxed);
+}
+
+bool PositionCache::save(const char* path) const {
+	std::vector<uint64_t> keys;
+	std::vector<uint8_t> cells;
+	for (size_t i = 0; i < size(); i++) {
+		uint64_t e = table[i].load(std::memory_order_relaxed);
+		if (e != 0) {
+			// the slot index holds the key bits the tag drops
+			keys.push_back((e & tag_mask) | (i & 0xff));
+			cells.push_back(uint8_t((e & 0xff) - 1));
+		}
+	}
+
+	FILE* out = fopen(path, "wb");
+	if (out == nullptr) {
+		return false;
+	}
+
+	uint64_t entries = keys.size();
+	bool ok = fwrite(magic, sizeof(magic), 1, out) == 1
+		&& fwrite(&entries, sizeof(entries), 1, out) == 1
+		&& fwrite(keys.data(), sizeof(uint64_t), entries, out) == entries
+		&& fwrite(cells.data(), 1, entries, out) == entries;
+
+	return fclose(out) == 0 && ok;
+}
+
+bool PositionCache::load(const char* path) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || size_t(st.st_size) < 16) {
+		close(fd);
+		return false;
+	}
+
+	void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	const char* bytes = static_cast<const char*>(data);
+	uint64_t entries;
+	memcpy(&entries, bytes + 8, sizeof(entries));
+	bool ok = memcmp(bytes, magic, sizeof(magic)) == 0
+		&& entries == (size_t(st.st_size) - 16) / 9 && size_t(st.st_size) == 16 + 9 * entries;
+
+	if (ok) {
+		const uint64_t* keys = reinterpret_cast<const uint64_t*>(bytes + 16);
+		const uint8_t* cells = reinterpret_cast<const uint8_t*>(bytes + 16 + 8 * entries);
+		for (uint64_t i = 0; i < entries; i++) {
+			if (cells[i] < 100) {
+				store(keys[i], cells[i]);
+			}
+		}
+	}
+
+	munmap(data, st.st_size);
+	return ok;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Zobrist keys of the opponent's field as a bot sees it: one random word
+// per (cell, state) and per (ship length, ships of it left), xor-ed together
+enum class CellKey {
+	hit,
+	miss,
+	sunk
+};
+
+uint64_t zobrist(CellKey state, int cell);
+
+uint64_t zobrist_fleet(int ship_len, int count);
+
+// best shots of positions seen before, shared by any number of threads;
+// every entry is one atomic word (key tag | cell + 1), so readers never
+// see a torn entry and writers simply overwrite whatever was there
+struct PositionCache {
+	// entries is rounded up to a power of two
+	explicit PositionCache(size_t entries = size_t(1) << 20);
+
+	bool lookup(uint64_t key, int &cell) const;
+
+	void store(uint64_t key, int cell);
+
+	// only the filled slots are written: a 16-byte header with their
+	// number n, then their n keys, 8 bytes each, then their n cells, a
+	// byte each
+	bool save(const char* path) const;
+
+	// maps the file and merges its entries in, false if it's missing or broken
+	bool load(const char* path);
+
+	size_t size() const {
+		return mask + 1;
+	}
+
+private:
+	size_t mask;
+	std::unique_ptr<std::atomic<uint64_t>[]> table;
+};
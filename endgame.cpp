@@ -0,0 +1,569 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "endgame.h"
+#include "placement.h"
+#include "pool.h"
+#include "rng.h"
+
+namespace {
+
+// expected shots in fixed point, exact integer arithmetic keeps the
+// values (and so the chosen shots) the same on every thread count
+const uint32_t one = 1 << 16;
+const uint32_t infinite = ~uint32_t(0);
+
+// a consistent arrangement of the ships not sunk yet
+struct Layout {
+	Bitboard cells;
+	Bitboard ships[fleet_size];
+	int n;
+};
+
+// what the search needs of the shooter's view, the misses are already
+// taken into account by the layouts
+struct View {
+	Bitboard hits;
+	Bitboard sunk;
+};
+
+uint64_t hash(Bitboard b) {
+	uint64_t h = b.lo;
+	h = splitmix64(h) ^ b.hi;
+	return splitmix64(h);
+}
+
+// values of positions: key tag in the upper 39 bits, a flag for values
+// that are only a lower bound and the value in the lower 24 bits; a value
+// is never 0, so an empty entry never matches.
+// A position is keyed on what decides its value, the layouts (without the
+// ships sunk already) and the hits on ships still afloat: views that rule
+// out the same layouts with different misses share the entry, and so do
+// the same positions met in later turns and other games
+const int table_bits = 20;
+const uint64_t value_mask = (uint64_t(1) << 24) - 1;
+const uint64_t lower_flag = uint64_t(1) << 24;
+const uint64_t tag_mask = ~(value_mask | lower_flag);
+
+std::atomic<uint64_t>* table() {
+	static std::unique_ptr<std::atomic<uint64_t>[]> entries = [] {
+		std::unique_ptr<std::atomic<uint64_t>[]> t(new std::atomic<uint64_t>[size_t(1) << table_bits]);
+		for (size_t i = 0; i < size_t(1) << table_bits; i++) {
+			t[i].store(0, std::memory_order_relaxed);
+		}
+		return t;
+	}();
+	return entries.get();
+}
+
+std::atomic<uint64_t>& entry(uint64_t key) {
+	return table()[key & ((uint64_t(1) << table_bits) - 1)];
+}
+
+bool lookup(uint64_t key, uint32_t &value, bool &lower) {
+	uint64_t e = entry(key).load(std::memory_order_relaxed);
+	if (e == 0 || (e & tag_mask) != (key & tag_mask)) {
+		return false;
+	}
+	value = uint32_t(e & value_mask);
+	lower = (e & lower_flag) != 0;
+	return true;
+}
+
+// a bound never replaces the exact value of the same position
+void store(uint64_t key, uint32_t value, bool lower) {
+	if (value > value_mask) {
+		return;
+	}
+	std::atomic<uint64_t> &e = entry(key);
+	if (lower) {
+		uint64_t old = e.load(std::memory_order_relaxed);
+		if (old != 0 && (old & tag_mask) == (key & tag_mask) && (old & lower_flag) == 0) {
+			return;
+		}
+	}
+	e.store((key & tag_mask) | (lower ? lower_flag : 0) | value, std::memory_order_relaxed);
+}
+
+struct Deadline {
+	bool limited;
+	std::chrono::steady_clock::time_point at;
+	std::atomic<bool>* expired;
+	int ticks = 0;
+
+	// checks the clock once in a while, true once the time is out
+	bool check() {
+		if (++ticks % 256 == 0 && limited && !expired->load(std::memory_order_relaxed)
+				&& std::chrono::steady_clock::now() >= at) {
+			expired->store(true, std::memory_order_relaxed);
+		}
+		return expired->load(std::memory_order_relaxed);
+	}
+};
+
+// lists the layouts, false if there are more than the limit or time ran out
+struct Enumerator {
+	Bitboard blocked;
+	Bitboard open_hits;
+	int count[5];
+	int limit;
+	Deadline* deadline;
+	std::vector<Layout> &out;
+	Layout current{};
+
+	bool run(Bitboard taken) {
+		// the ship through the lowest hit not covered yet can be of any length left
+		Bitboard uncovered = open_hits & ~current.cells;
+		if (uncovered.any()) {
+			Bitboard target = Bitboard::bit(uncovered.lowest());
+			for (int ship_len = 1; ship_len < 5; ship_len++) {
+				if (count[ship_len] == 0) {
+					continue;
+				}
+				for (const Placement &p : placements(ship_len)) {
+					// a whole ship of hits would have been reported sunk
+					if ((p.ship & target).empty() || (p.ship & taken).any() || (p.halo & open_hits).any()
+							|| (p.ship & ~open_hits).empty()) {
+						continue;
+					}
+					if (!place(p, ship_len, taken, nullptr)) {
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+		return fill(taken, nullptr);
+	}
+
+	// the ships away from the hits, longest first, ships of the same length
+	// in the order of the table so every layout comes once
+	bool fill(Bitboard taken, const Placement* after) {
+		int ship_len = 4;
+		while (ship_len > 0 && count[ship_len] == 0) {
+			ship_len--;
+		}
+		if (ship_len == 0) {
+			if (int(out.size()) == limit) {
+				return false;
+			}
+			out.push_back(current);
+			return true;
+		}
+
+		PlacementRange range = placements(ship_len);
+		for (const Placement* p = after != nullptr ? after + 1 : range.begin(); p != range.end(); p++) {
+			if ((p->ship & taken).empty() && !place(*p, ship_len, taken, p)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool place(const Placement &p, int ship_len, Bitboard taken, const Placement* after) {
+		if (deadline->check()) {
+			return false;
+		}
+		Layout saved = current;
+		current.cells |= p.ship;
+		current.ships[current.n++] = p.ship;
+		count[ship_len]--;
+		taken |= p.ship | p.halo;
+
+		bool ok;
+		if ((open_hits & ~current.cells).any()) {
+			ok = run(taken);
+		} else {
+			// the next ship of the same length goes after this one
+			ok = fill(taken, after != nullptr && count[ship_len] > 0 ? after : nullptr);
+		}
+
+		count[ship_len]++;
+		current = saved;
+		return ok;
+	}
+};
+
+// a layout of a position and its key there
+struct Item {
+	uint64_t key;
+	uint32_t layout;
+};
+
+uint64_t position_key(const View &v, uint64_t layouts_key) {
+	return splitmix64(layouts_key) ^ hash(v.hits & ~v.sunk);
+}
+
+// expectimax over the layouts of one worker; a node's layouts are a range
+// of items, the layouts of its children are grouped one level deeper.
+// A value is searched only as far as the caller needs it: below the limit
+// it's exact, otherwise the search stops at some lower bound that reaches
+// the limit
+struct Search {
+	const Layout* layouts;
+	Deadline deadline;
+	std::vector<std::vector<Item>> levels;
+	std::vector<uint8_t> outcome;
+
+	struct Group {
+		uint64_t shown;
+		Bitboard hidden;
+	};
+	std::vector<Group> groups;
+
+	// every level is one more shot, so there are at most 101 of them
+	Item* level(int depth, size_t n) {
+		if (levels.empty()) {
+			levels.resize(101);
+		}
+		if (levels[depth].size() < n) {
+			levels[depth].resize(n);
+		}
+		return levels[depth].data();
+	}
+
+	// the cells that hold a ship in some layout, the most covered first.
+	// Cells with a ship in the same layouts are worth the same, whichever
+	// is shot first the other one is a sure hit or a sure miss after it, so
+	// only the first of them is kept. A cell with a ship in every layout has
+	// to be shot sooner or later, and shooting it now only tells more
+	// earlier, so then it's the only one
+	int candidates(const View &v, const Item* items, uint32_t n, int* cells, uint32_t* cover) {
+		uint32_t counts[100] = {};
+		uint64_t layouts_of[100] = {};
+		for (uint32_t i = 0; i < n; i++) {
+			for (Bitboard b = layouts[items[i].layout].cells & ~v.hits; b.any(); ) {
+				int c = b.pop();
+				counts[c]++;
+				layouts_of[c] ^= items[i].key;
+			}
+		}
+		int k = 0;
+		for (int c = 0; c < 100; c++) {
+			if (counts[c] == 0) {
+				continue;
+			}
+			if (counts[c] == n) {
+				cells[0] = c;
+				cover[0] = n;
+				return 1;
+			}
+			bool same = false;
+			for (int j = 0; j < k && !same; j++) {
+				same = cover[j] == counts[c] && layouts_of[cells[j]] == layouts_of[c];
+			}
+			if (same) {
+				continue;
+			}
+			int j = k++;
+			for (; j > 0 && cover[j - 1] < counts[c]; j--) {
+				cells[j] = cells[j - 1];
+				cover[j] = cover[j - 1];
+			}
+			cells[j] = c;
+			cover[j] = counts[c];
+		}
+		return k;
+	}
+
+	// no play can do better: every cell not hit yet takes a shot, and the
+	// misses summed over the n layouts are at least the given ones
+	static uint32_t bound(int unhit, uint32_t n, uint64_t misses) {
+		return one * unhit + uint32_t(uint64_t(one) * misses / n);
+	}
+
+	// misses summed over the layouts: while shots miss, the layouts left are
+	// at least n less the cover of the cells shot, the most covered ones at
+	// best; cover is sorted, the cell at index first is shot first, -1 for any
+	static uint64_t spine(uint32_t n, const uint32_t* cover, int k, int first) {
+		uint64_t misses = 0;
+		int64_t left = n;
+		if (first != -1) {
+			left -= cover[first];
+			misses += left;
+		}
+		for (int j = 0; j < k && left > 0; j++) {
+			if (j != first) {
+				left -= cover[j];
+				misses += left > 0 ? left : 0;
+			}
+		}
+		return misses;
+	}
+
+	// the same when all ships but one are shown: in every layout the shortest
+	// ship not hit yet is left hidden, the layouts that differ only in it go
+	// together and the rest of their ships are shot without a miss
+	uint64_t hidden_spine(const View &v, const Item* items, uint32_t n) {
+		groups.resize(n);
+		for (uint32_t i = 0; i < n; i++) {
+			const Layout &l = layouts[items[i].layout];
+			Bitboard hidden;
+			for (int j = 0; j < l.n; j++) {
+				Bitboard ship = l.ships[j];
+				if ((ship & v.hits).empty() && (hidden.empty() || ship.count() < hidden.count()
+						|| (ship.count() == hidden.count() && ship.lowest() < hidden.lowest()))) {
+					hidden = ship;
+				}
+			}
+			groups[i] = Group{hash(l.cells & ~hidden & ~v.sunk), hidden};
+		}
+		std::sort(groups.begin(), groups.begin() + n, [](const Group &a, const Group &b) {
+			return a.shown < b.shown;
+		});
+
+		uint64_t misses = 0;
+		for (uint32_t begin = 0, end; begin < n; begin = end) {
+			uint32_t counts[100] = {};
+			Bitboard cells;
+			for (end = begin; end < n && groups[end].shown == groups[begin].shown; end++) {
+				cells |= groups[end].hidden;
+				for (Bitboard b = groups[end].hidden; b.any(); ) {
+					counts[b.pop()]++;
+				}
+			}
+			uint32_t cover[100];
+			int k = 0;
+			while (cells.any()) {
+				uint32_t c = counts[cells.pop()];
+				int j = k++;
+				for (; j > 0 && cover[j - 1] < c; j--) {
+					cover[j] = cover[j - 1];
+				}
+				cover[j] = c;
+			}
+			misses += spine(end - begin, cover, k, -1);
+		}
+		return misses;
+	}
+
+	// expected shots to finish from the view, the layouts items[0..n) agree with it
+	uint32_t value(const View &v, int unhit, const Item* items, uint32_t n, uint64_t key, int depth,
+			uint32_t limit) {
+		if (n == 1) {
+			return one * unhit;
+		}
+		uint32_t known;
+		bool lower;
+		if (lookup(key, known, lower) && (!lower || known >= limit)) {
+			return known;
+		}
+		if (deadline.check()) {
+			return 0;
+		}
+
+		int cells[100];
+		uint32_t cover[100];
+		int k = candidates(v, items, n, cells, cover);
+		// values are raised to their bounds where rounding took them below,
+		// so a shot cut off by its bound is never one that would have won
+		uint32_t least = bound(unhit, n, std::max(spine(n, cover, k, -1), hidden_spine(v, items, n)));
+		if (least >= limit) {
+			store(key, least, true);
+			return least;
+		}
+		uint32_t best = infinite;
+		for (int i = 0; i < k && best > least; i++) {
+			uint32_t cutoff = best < limit ? best : limit;
+			uint32_t low = std::max(least, bound(unhit, n, spine(n, cover, k, i)));
+			uint32_t shot = low >= cutoff ? low : std::max(low, shoot(v, unhit, items, n, depth, cells[i], cutoff));
+			best = shot < best ? shot : best;
+		}
+
+		if (deadline.expired->load(std::memory_order_relaxed)) {
+			return 0;
+		}
+		store(key, best, best >= limit);
+		return best;
+	}
+
+	// expected shots with this shot first, searched up to the cutoff
+	uint32_t shoot(const View &v, int unhit, const Item* items, uint32_t n, int depth, int cell,
+			uint32_t cutoff) {
+		Bitboard shot = Bitboard::bit(cell);
+
+		// 0 miss, 1 hit, 2 + k sinks the k-th ship shape
+		Bitboard shapes[20];
+		uint32_t shape_num[20];
+		int shapes_num = 0;
+		uint32_t misses = 0;
+		uint32_t hits = 0;
+		if (outcome.size() < n) {
+			outcome.resize(n);
+		}
+		for (uint32_t i = 0; i < n; i++) {
+			const Layout &l = layouts[items[i].layout];
+			if ((l.cells & shot).empty()) {
+				outcome[i] = 0;
+				misses++;
+				continue;
+			}
+			int j = 0;
+			while ((l.ships[j] & shot).empty()) {
+				j++;
+			}
+			if ((l.ships[j] & ~v.hits & ~shot).any()) {
+				outcome[i] = 1;
+				hits++;
+				continue;
+			}
+			int s = 0;
+			while (s < shapes_num && shapes[s] != l.ships[j]) {
+				s++;
+			}
+			if (s == shapes_num) {
+				shapes[shapes_num] = l.ships[j];
+				shape_num[shapes_num++] = 0;
+			}
+			shape_num[s]++;
+			outcome[i] = uint8_t(2 + s);
+		}
+
+		// the children's layouts one after another: misses, hits, every sunk
+		// shape; a layout's key changes only when its ship sinks
+		Item* next = level(depth + 1, n);
+		uint32_t start[23];
+		start[0] = 0;
+		start[1] = misses;
+		start[2] = misses + hits;
+		for (int s = 0; s < shapes_num; s++) {
+			start[3 + s] = start[2 + s] + shape_num[s];
+		}
+		uint32_t fill[22];
+		uint64_t keys[22] = {};
+		for (int g = 0; g < 2 + shapes_num; g++) {
+			fill[g] = start[g];
+		}
+		for (uint32_t i = 0; i < n; i++) {
+			int g = outcome[i];
+			Item item = items[i];
+			if (g >= 2) {
+				item.key = hash(layouts[item.layout].cells & ~(v.sunk | shapes[g - 2]));
+			}
+			keys[g] ^= item.key;
+			next[fill[g]++] = item;
+		}
+
+		// the sum starts at the lower bound of every child and gets exact child
+		// by child; the search stops once the shot can't get below the cutoff
+		uint64_t sum = uint64_t(misses) * one * unhit + uint64_t(n - misses) * one * (unhit - 1);
+		uint64_t stop = cutoff == infinite ? ~uint64_t(0) : uint64_t(cutoff - one) * n;
+		for (int g = 0; g < 2 + shapes_num; g++) {
+			uint32_t size = start[g + 1] - start[g];
+			if (size == 0) {
+				continue;
+			}
+			View child = v;
+			int child_unhit = unhit - 1;
+			if (g == 0) {
+				child_unhit = unhit;
+			} else {
+				child.hits |= shot;
+				if (g >= 2) {
+					child.sunk |= shapes[g - 2];
+				}
+			}
+			if (child_unhit == 0) {
+				continue;
+			}
+
+			// the child's value at which the sum reaches the stop
+			uint64_t floor = uint64_t(one) * child_unhit;
+			uint64_t child_limit = stop == ~uint64_t(0) ? infinite : floor + (stop - sum + size - 1) / size;
+			uint32_t child_value = value(child, child_unhit, next + start[g], size, position_key(child, keys[g]),
+				depth + 1, child_limit < infinite ? uint32_t(child_limit) : infinite);
+			sum += uint64_t(size) * (child_value - floor);
+			if (sum >= stop) {
+				uint64_t low = one + sum / n;
+				return low < infinite ? uint32_t(low) : infinite;
+			}
+		}
+		return one + uint32_t((sum + n / 2) / n);
+	}
+};
+
+}
+
+EndgameResult solve_endgame(const Board &other, const int* remaining, const EndgameLimits &limits) {
+	EndgameResult result;
+	if (limits.max_layouts <= 0) {
+		return result;
+	}
+
+	std::atomic<bool> expired{false};
+	auto deadline = [&] {
+		return Deadline{limits.budget_ms > 0,
+			std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.budget_ms), &expired};
+	};
+
+	std::vector<Layout> layouts;
+	Deadline enumeration = deadline();
+	Enumerator e{other.misses | other.halo | other.sunk, other.hits & ~other.sunk, {}, limits.max_layouts,
+		&enumeration, layouts};
+	int unhit = -e.open_hits.count();
+	for (int ship_len = 1; ship_len < 5; ship_len++) {
+		e.count[ship_len] = remaining[ship_len];
+		unhit += remaining[ship_len] * ship_len;
+	}
+	if (unhit <= 0 || !e.run(e.blocked) || layouts.empty()) {
+		return result;
+	}
+
+	View root{other.hits, other.sunk};
+	uint32_t n = uint32_t(layouts.size());
+	std::vector<Item> items(n);
+	for (uint32_t i = 0; i < n; i++) {
+		items[i] = Item{hash(layouts[i].cells), i};
+	}
+
+	int threads = limits.threads > 0 ? limits.threads : 1;
+	std::vector<Search> workers(threads);
+	for (Search &s : workers) {
+		s.layouts = layouts.data();
+		s.deadline = enumeration;
+	}
+	int cells[100];
+	uint32_t cover[100];
+	int k = workers[0].candidates(root, items.data(), n, cells, cover);
+	uint32_t least = Search::bound(unhit, n, std::max(Search::spine(n, cover, k, -1),
+		workers[0].hidden_spine(root, items.data(), n)));
+
+	// a shot is given up only when it's worse than one found, never on a
+	// tie, so the first best shot in the order wins on any number of threads
+	std::atomic<uint32_t> best{infinite};
+	std::vector<uint32_t> values(k, infinite);
+	parallel_for(k, threads, 1, [&](int worker, uint64_t begin, uint64_t end) {
+		Search &s = workers[worker];
+		for (uint64_t i = begin; i < end; i++) {
+			uint32_t found = best.load(std::memory_order_relaxed);
+			uint32_t cutoff = found == infinite ? infinite : found + 1;
+			uint32_t low = std::max(least, Search::bound(unhit, n, Search::spine(n, cover, k, int(i))));
+			if (low >= cutoff) {
+				continue;
+			}
+			uint32_t v = std::max(low, s.shoot(root, unhit, items.data(), n, 0, cells[i], cutoff));
+			if (v >= cutoff) {
+				continue;
+			}
+			values[i] = v;
+			while (v < found && !best.compare_exchange_weak(found, v, std::memory_order_relaxed)) {
+			}
+		}
+	});
+	if (expired.load(std::memory_order_relaxed)) {
+		return result;
+	}
+
+	int chosen = 0;
+	for (int i = 1; i < k; i++) {
+		if (values[i] < values[chosen]) {
+			chosen = i;
+		}
+	}
+	result.cell = cells[chosen];
+	result.expected = double(values[chosen]) / one;
+	result.layouts = int(n);
+	return result;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "board.h"
+
+// Exact play at the end of a game. All arrangements of the ships not sunk
+// yet that agree with the view of the opponent's field are listed, each
+// taken as equally likely, and an expectimax search over the shots finds
+// the one with the fewest expected shots to sink them all. Values of
+// positions are kept in a transposition table keyed on the view's
+// bitplanes (the fleet left follows from the sunk cells), shared by all
+// threads and all games.
+
+struct EndgameLimits {
+	// positions with more consistent layouts aren't solved, 0 turns the solver off
+	int max_layouts = 0;
+	// the shots at the root are shared out between this many threads
+	int threads = 1;
+	// per turn, 0 for no limit; a search that runs out of it gives no shot
+	int budget_ms = 0;
+};
+
+struct EndgameResult {
+	int cell = -1; // -1 if the position wasn't solved
+	double expected = 0; // shots to sink the rest of the fleet, this one included
+	int layouts = 0;
+};
+
+// remaining[len] is the number of ships of length len (1..4) not sunk yet;
+// with no time limit the result depends on the position only
+EndgameResult solve_endgame(const Board &other, const int* remaining, const EndgameLimits &limits);
@@ -0,0 +1,27 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "protocol.h"
+
+// Fuzz entry for the frame decoder, for libFuzzer (-DBATTLESHIP_FUZZ=ON
+// with clang builds battleship-fuzz) and for the random bytes test in
+// battleship-tests. The input is cut into frames as a receiver would cut
+// a stream; every frame that decodes must encode back to the same bytes
+// and is applied to a spectator's view, as the server and the clients do.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	MatchView view;
+	for (size_t pos = 0; pos + frame_size <= size; pos += frame_size) {
+		Frame frame;
+		if (!decode(data + pos, frame)) {
+			continue;
+		}
+		uint8_t bytes[frame_size];
+		encode(frame, bytes);
+		if (memcmp(bytes, data + pos, frame_size) != 0) {
+			abort();
+		}
+		view.apply(frame);
+	}
+	return 0;
+}
@@ -1,43 +1,78 @@
 #include <ncurses.h>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <random>
 #include "GameState.h"
+#include "assets.h"
 #include "menu.h"
-#include <random>
-
-enum class ShotRes {
-	hit,
-	miss,
-	sank,
-	game_over
-};
-
-enum class GameRes {
-	win,
-	loss
-};
-
-struct Coord {
-	int x, y;
-};
-
-struct AbstractPlayer {
-	virtual void arrange_ships() = 0;
+#include "player.h"
+#include "bots.h"
+#include "net.h"
+#include "loop.h"
+#include "pool.h"
+#include "record.h"
+#include "render.h"
+#include "replay.h"
+#include "sim.h"
+
+static void print_field(WINDOW* &field) {
+	// field color
+	wbkgd(field, COLOR_PAIR(2)); 					
+	box(field, 0, 0);
+
+	// field lines 
+	mvwvline(field, 3, 3, 0, 10);
+	mvwhline(field, 2, 4, 0, 20);
+
+	mvwaddch(field, 2, 3, ACS_PLUS);
+
+	mvwaddch(field, 2, 0, ACS_LTEE);
+	mvwaddch(field, 0, 3, ACS_TTEE);
+
+	mvwaddch(field, 2, 1, ACS_HLINE);
+	mvwaddch(field, 2, 2, ACS_HLINE);
+	mvwaddch(field, 1, 3, ACS_VLINE);
+
+	mvwaddch(field, 2, 24, ACS_RTEE);
+	mvwaddch(field, 13, 3, ACS_BTEE);
+
+	// field chars and numbers
+	for (int i = 0; i < 10; i++) {
+		mvwaddch(field, 1, i * 2 + 4, char(int('A') + i));
+		if (i < 9) {
+			mvwaddch(field, i + 3, 2, char(int('1') + i));
+		}
+	}
+	mvwprintw(field, 12, 1, "10");
+}
 
-	virtual Coord take_shot() = 0;
+// the two fields side by side with their shadows and the title above them,
+// laid out again when the terminal is resized
+struct GameScreen {
+	GameScreen() : view1(nullptr), view2(nullptr), resize([this] { layout(); }) {
+		layout();
+	}
 
-	virtual ShotRes get_shot(Coord) = 0;
+	~GameScreen() {
+		close();
+	}
 
-	virtual void get_res(ShotRes, Coord) = 0;
+	GameScreen(const GameScreen&) = delete;
+	GameScreen& operator=(const GameScreen&) = delete;
 
-	virtual void game_res(GameRes) = 0;
+	WINDOW* field1 = nullptr;
+	WINDOW* field2 = nullptr;
+	WINDOW* shadow1 = nullptr;
+	WINDOW* shadow2 = nullptr;
+	BoardView view1;
+	BoardView view2;
 
-	int field_m[10][10];
-	int other_field_m[10][10];
-	int health_points[10];
-	int alive_ships_num = 10;
-};
+private:
+	// empty fields centered on the screen, the views repaint every cell next time
+	void layout() {
+		close();
 
-struct LocalPlayer : AbstractPlayer {
-	LocalPlayer() {
 		int row, col;
 		getmaxyx(stdscr, row, col);
 		int height = 14;
@@ -46,46 +81,58 @@ struct LocalPlayer : AbstractPlayer {
 
 		int field1x = (col - width * 2 - gap_size) / 2;
 		field1 = newwin(height, width, (row - height) / 2, field1x);
-		print_field(field1, true);
+		print_field(field1);
 
 		shadow1 = newwin(height, width, (row - height) / 2 + 1, field1x + 1);
 		wbkgd(shadow1, COLOR_PAIR(3));
 		
 		field2 = newwin(height, width, (row - height) / 2, field1x + width + gap_size);
-		print_field(field2, true);
+		print_field(field2);
 
 		shadow2 = newwin(height, width, (row - height) / 2 + 1, field1x + width + gap_size + 1);
 		wbkgd(shadow2, COLOR_PAIR(3));
 
-		for (int i = 0; i < row; i++) {
-			for (int j = 0; j < col; j++) {
-				mvprintw(i, j, " ");
-			}
-		}
+		view1.win = field1;
+		view2.win = field2;
+		view1.invalidate();
+		view2.invalidate();
 
+		erase();
 		print_centered_title(row, col, height);
 
-		refresh();
-		wrefresh(shadow1);
-		wrefresh(shadow2);
-		wrefresh(field1);
-		wrefresh(field2);
+		wnoutrefresh(stdscr);
+		wnoutrefresh(shadow1);
+		wnoutrefresh(shadow2);
 	}
 
-	virtual void arrange_ships() override {
-		for (int i = 0; i < 10; i++) {
-			for (int j = 0; j < 10; j++) {
-				field_m[i][j] = 0;
-				other_field_m[i][j] = 0;
+	void close() {
+		for (WINDOW* win : {field1, field2, shadow1, shadow2}) {
+			if (win != nullptr) {
+				delwin(win);
 			}
 		}
+	}
+
+	OnResize resize;
+};
+
+struct LocalPlayer : AbstractPlayer {
+	LocalPlayer() : resize([this] { redraw(); }) {
+		redraw();
+		update_screen();
+	}
+
+	virtual const char* name() const override {
+		return "local";
+	}
+
+	virtual void arrange_ships() override {
+		field_m.clear();
+		other_field_m.clear();
 
-		int ship_num = 1;
 		for (int ship_len = 4; ship_len > 0; ship_len--) {
 			for (int i = 0; i < 5 - ship_len; i++) {
-				get_ship(ship_len, ship_num);
-				health_points[ship_num - 1] = ship_len;
-				ship_num++;
+				get_ship(ship_len);
 			}
 		}
 	}
@@ -94,10 +141,10 @@ struct LocalPlayer : AbstractPlayer {
 		int x = 4, y = 4, ch;
 
 		do {
-			print_cursor(field2, x, y);
-			wrefresh(field2);
+			print_cursor(x, y);
+			update_screen();
 
-			switch (ch = getch()) {
+			switch (ch = next_key()) {
 				case KEY_DOWN:
 					if (y < 9) {
 						y++;
@@ -119,7 +166,7 @@ struct LocalPlayer : AbstractPlayer {
 					}
 					break;
 				case '\n':
-					if (other_field_m[y][x] == 0) {
+					if (other_field_m.unknown().test(x, y)) {
 						return Coord{x, y};
 					} 
 					break;
@@ -128,234 +175,95 @@ struct LocalPlayer : AbstractPlayer {
 	}
 
 	ShotRes get_shot(Coord xy) override {
-		ShotRes res;
-		if (field_m[xy.y][xy.x] < 1 || 10 < field_m[xy.y][xy.x]) {
-			field_m[xy.y][xy.x] = 12;
-			res = ShotRes::miss;
-		} else {
-			int ship_num = field_m[xy.y][xy.x];
-
-			health_points[ship_num - 1]--;
-
-			field_m[xy.y][xy.x] = 13;
-
-			if (health_points[ship_num - 1] > 0) {
-				return ShotRes::hit;
-			} else {
-				alive_ships_num--;
-				if (alive_ships_num > 0) {
-					return ShotRes::sank;
-				} else {
-					return ShotRes::game_over;
-				}
-			}
-		}
-
-		print_ships(field1, field_m);
-
+		ShotRes res = field_m.shoot(xy);
+		show(screen.view1, field_m, false);
+		update_screen();
 		return res;
 	}
 
 	virtual void get_res(ShotRes res, Coord shot) override {
-		if (res == ShotRes::miss) {
-			other_field_m[shot.y][shot.x] = 12;
-		} else if (res == ShotRes::hit) {
-			other_field_m[shot.y][shot.x] = 13;
-		} else if (res == ShotRes::sank) {
-			other_field_m[shot.y][shot.x] = 13;
-			int dir[4][2] = {
-				{1, 0},
-				{0, 1},
-				{-1, 0},
-				{0, -1}
-			};
-
-			for (int i = 0; i < 4; i++) {
-				for (int j = 0; j < 4; j++) {
-					int x = shot.x + dir[i][0] * j;
-					int y = shot.y + dir[i][1] * j;
-					if (in_range(x) && in_range(y) && (other_field_m[y][x] == 13
-							|| other_field_m[y][x] == 14)) {
-						other_field_m[y][x] = 14;
-						fill_empty_neighbors(12, x, y, other_field_m);
-					} else {
-						break;
-					}
-				}
-			}
+		other_field_m.record(res, shot);
+		if (res == ShotRes::sank) {
+			other_field_m.mark_sunk(shot);
 		}
-		print_ships(field2, other_field_m);
+		show(screen.view2, other_field_m, true);
+		update_screen();
 	}
 
 
 	virtual void game_res(GameRes res) {
-		int row, col;
-		getmaxyx(stdscr, row, col);
-
-		for (int i = 0; i < row; i++) {
-			for (int j = 0; j < col; j++) {
-				mvprintw(i, j, " ");
-			}
-		}
-
 		int height;
 		int width;
 		int color;
 
-		std::string addr;
-		std::string line;
-		std::vector<std::string> text;
+		const TextAsset* text;
 
 		if (res == GameRes::win) {
 			height = 7 + 4;
 			width = 59 + 6;
 			color = 2;
-			addr = "win.txt";
+			text = &asset(Asset::win);
 		} else {
 			height = 7 + 4;
 			width = 71 + 6;
 			color = 4;
-			addr = "lose.txt";
+			text = &asset(Asset::lose);
 		}
 
-		WINDOW* field = newwin(height, width, (row - height) / 2, (col - width) / 2);
-		wbkgd(field, COLOR_PAIR(color)); 					
-		box(field, 0, 0);
+		// drawn again over the fields after a resize
+		do {
+			int row, col;
+			getmaxyx(stdscr, row, col);
 
-		WINDOW* shadow = newwin(height, width, (row - height) / 2 + 1, (col - width) / 2 + 1);
-		wbkgd(shadow, COLOR_PAIR(3));
+			erase();
 
-		print_centered_title(row, col, height);
+			WINDOW* field = newwin(height, width, (row - height) / 2, (col - width) / 2);
+			wbkgd(field, COLOR_PAIR(color)); 					
+			box(field, 0, 0);
 
-		std::ifstream in(addr);
+			WINDOW* shadow = newwin(height, width, (row - height) / 2 + 1, (col - width) / 2 + 1);
+			wbkgd(shadow, COLOR_PAIR(3));
 
-		if (in.is_open()) {
-			while (std::getline(in, line)) {
-				text.push_back(line);
-			}
-		}
+			print_centered_title(row, col, height);
 
-		in.close();
+			for (size_t i = 0; i < text->lines(); i++) {
+				std::string_view line = text->line(i);
+				mvwprintw(field, 2 + i, 3, "%.*s", int(line.size()), line.data());
+			}
 
-		for (int i = 0; i < text.size(); i++) {
-			mvwprintw(field, 2 + i, 3, text[i].c_str());
-		}
+			wnoutrefresh(stdscr);
+			wnoutrefresh(shadow);
+			wnoutrefresh(field);
+			update_screen();
 
-		refresh();
-		wrefresh(shadow);
-		wrefresh(field);
-		getch();
+			delwin(field);
+			delwin(shadow);
+		} while (next_key() == KEY_RESIZE);
 	}
 
  private:
-	void fill_empty_neighbors(int val, int x, int y, int (& field_l)[10][10]) {
-		int neighbours[8][2] = {
-			{0, 1},
-			{0, -1},
-			{1, 0},
-			{-1, 0},
-			{1, 1},
-			{1, -1},
-			{-1, 1},
-			{-1, -1}
-		};
-
-		for (int j = 0; j < 8; j++) {
-			int dx = x + neighbours[j][0];
-			int dy = y + neighbours[j][1];
-			if (in_range(dy) && in_range(dx) && field_l[dy][dx] == 0) {
-				field_l[dy][dx] = val;
-			}
-		}
+	void redraw() {
+		show(screen.view1, field_m, false);
+		show(screen.view2, other_field_m, true);
 	}
 
-	void print_squares(WINDOW* &field) {
-		for (int i = 0; i < 10; i++) {
-			for (int j = 0; j < 10; j++) {
-				if ((i + j) % 2 == 0) {
-					wattron(field, COLOR_PAIR(7));
-				} else {
-					wattron(field, COLOR_PAIR(10));
-				}
-				mvwprintw(field, i + 3, j * 2 + 4, "  ");
-				if ((i + j) % 2 == 0) {
-					wattroff(field, COLOR_PAIR(7));
-				} else {
-					wattroff(field, COLOR_PAIR(10));
-				}
-			}
-		}
+	void show(BoardView &view, const Board &board, bool other) {
+		short colors[100];
+		board_colors(board, other, colors);
+		view.draw(colors);
 	}
 
-	void print_cursor(WINDOW* &field, int x, int y) {
-		print_squares(field);
-		for (int i = 0; i < 10; i++) {
-			for (int j = 0; j < 10; j++) {
-				if (other_field_m[i][j] == 12) {
-					wattron(field, COLOR_PAIR(2));
-				} else if (other_field_m[i][j] == 13) {
-					wattron(field, COLOR_PAIR(13));
-				}	else if (other_field_m[i][j] == 14) {
-					wattron(field, COLOR_PAIR(14));
-				}
-
-				if (other_field_m[i][j] != 0) {
-					mvwprintw(field, i + 3, j * 2 + 4, "  ");
-				}
-				if (other_field_m[i][j] == 12) {
-					wattroff(field, COLOR_PAIR(2));
-				} else if (other_field_m[i][j] == 13) {
-					wattroff(field, COLOR_PAIR(13));
-				} else if (other_field_m[i][j] == 14) {
-					wattroff(field, COLOR_PAIR(14));
-				}
-			}
-		}
-
-		wattron(field, COLOR_PAIR(6));
-		mvwprintw(field, y + 3, x * 2 + 4, "  ");
-		wattroff(field, COLOR_PAIR(6));
-	}
-
-
-	void print_field(WINDOW* &field, bool squares) {
-		// field color
-		wbkgd(field, COLOR_PAIR(2)); 					
-		box(field, 0, 0);
-
-		// field lines 
-		mvwvline(field, 3, 3, 0, 10);
-		mvwhline(field, 2, 4, 0, 20);
-
-		mvwaddch(field, 2, 3, ACS_PLUS);
-
-		mvwaddch(field, 2, 0, ACS_LTEE);
-		mvwaddch(field, 0, 3, ACS_TTEE);
-
-		mvwaddch(field, 2, 1, ACS_HLINE);
-		mvwaddch(field, 2, 2, ACS_HLINE);
-		mvwaddch(field, 1, 3, ACS_VLINE);
-
-		mvwaddch(field, 2, 24, ACS_RTEE);
-		mvwaddch(field, 13, 3, ACS_BTEE);
-
-		// field chars and numbers
-		for (int i = 0; i < 10; i++) {
-			mvwaddch(field, 1, i * 2 + 4, char(int('A') + i));
-			if (i < 9) {
-				mvwaddch(field, i + 3, 2, char(int('1') + i));
-			}
-		}
-		mvwprintw(field, 12, 1, "10");
-
-
-		// field squares
-		if (squares) {
-			print_squares(field);
+	// while aiming, hits of ships that aren't sunk yet are grey
+	void print_cursor(int x, int y) {
+		short colors[100];
+		board_colors(other_field_m, true, colors);
+		for (Bitboard open_hits = other_field_m.hits & ~other_field_m.sunk; open_hits.any(); ) {
+			colors[open_hits.pop()] = 13;
 		}
+		colors[y * 10 + x] = 6;
+		screen.view2.draw(colors);
 	}
 
-
 	int max_y(int ship_len, int orientation) {
 		return 10 - orientation * (ship_len - 1);
 	}
@@ -364,90 +272,30 @@ struct LocalPlayer : AbstractPlayer {
 		return 10 - (1 - orientation) * (ship_len - 1);
 	}
 
-	bool in_range(int x) {
-		return (0 <= x && x < 10);
-	}
+	// the fleet placed so far and the ship being placed, red where it doesn't fit
+	void print_ships(int x, int y, int ship_len, int orientation) {
+		short colors[100];
+		board_colors(field_m, false, colors);
 
-	bool occupied(int x, int y, int ship_len, int orientation) {
-		bool flag = false;
-		for (int i = 0; i < ship_len; i++) {
-			int xx = x;
-			int yy = y;
-			if (orientation == 0) {
-				xx += i;
-			} else {
-				yy += i;
-			}
-			if (field_m[yy][xx] != 0) {
-				flag = true;
-			}
+		Bitboard taken = field_m.ships | field_m.halo;
+		for (Bitboard ship = ship_mask(ship_len, x, y, orientation); ship.any(); ) {
+			int i = ship.pop();
+			colors[i] = taken.test(i) ? 14 : 13;
 		}
-		return flag;
-	}
-
-	void print_ships(WINDOW* &fieldw, int x, int y, int ship_len, int orientation) {
-		print_squares(fieldw);
-		refresh();
-		for (int i = 0; i < 10; i++) {
-			for (int j = 0; j < 10; j++) {
-				if (0 < field_m[i][j] && field_m[i][j] < 11) {
-					wattron(fieldw, COLOR_PAIR(13));
-					mvwprintw(fieldw, i + 3, j * 2 + 4, "  ");
-					wattroff(fieldw, COLOR_PAIR(13));
-				}
-			}
-		}
-		refresh();
-
-		wattron(fieldw, COLOR_PAIR(13));
-		for (int i = 0; i < ship_len; i++) {
-			if (field_m[y + i * orientation][x + i * (1 - orientation)] != 0) {
-				wattron(fieldw, COLOR_PAIR(14));
-			}
-			mvwprintw(fieldw, y + 3 + i * orientation, (x + i * (1 - orientation)) * 2 + 4, "  ");
-			if (field_m[y + i * orientation][x + i * (1 - orientation)] != 0) {
-				wattron(fieldw, COLOR_PAIR(13));
-			}
-		}
-		wattroff(fieldw, COLOR_PAIR(13));
-		refresh();
-	}
-
-	void print_ships(WINDOW* &fieldw, int (& field_l)[10][10]) {
-		print_squares(fieldw);
-		refresh();
-		for (int i = 0; i < 10; i++) {
-			for (int j = 0; j < 10; j++) {
-				if (0 < field_l[i][j] && field_l[i][j] < 11) {
-					wattron(fieldw, COLOR_PAIR(13));
-					mvwprintw(fieldw, i + 3, j * 2 + 4, "  ");
-					wattroff(fieldw, COLOR_PAIR(13));
-				} else if (field_l[i][j] == 12) {
-					wattron(fieldw, COLOR_PAIR(5));
-					mvwprintw(fieldw, i + 3, j * 2 + 4, "  ");
-					wattroff(fieldw, COLOR_PAIR(5));
-				} else if (field_l[i][j] == 13) {
-					wattron(fieldw, COLOR_PAIR(14));
-					mvwprintw(fieldw, i + 3, j * 2 + 4, "  ");
-					wattroff(fieldw, COLOR_PAIR(14));
-				}
-			}
-		}
-		wrefresh(fieldw);
-		refresh();
+		screen.view1.draw(colors);
 	}
 
-	void get_ship(int ship_len, int ship_num) {
+	void get_ship(int ship_len) {
 		int x = 3, y = 3, ch;
 
 		// vertical = 1, horizontal = 0
 		int orientation = 0; 			
 
 		do {
-			print_ships(field1, x, y, ship_len, orientation);
-			wrefresh(field1);
+			print_ships(x, y, ship_len, orientation);
+			update_screen();
 
-			switch (ch = getch()) {
+			switch (ch = next_key()) {
 				case KEY_DOWN:
 					if (y + 1 < max_y(ship_len, orientation)) {
 						y++;
@@ -478,18 +326,8 @@ struct LocalPlayer : AbstractPlayer {
 					}
 					break;
 				case '\n':
-					if (!occupied(x, y, ship_len, orientation)) {
-						for (int i = 0; i < ship_len; i++) {
-							int dx = x;
-							int dy = y;
-							if (orientation == 0) {
-								dx += i;
-							} else {
-								dy += i;
-							}
-							fill_empty_neighbors(11, dx, dy, field_m);
-							field_m[dy][dx] = ship_num;
-						}
+					if (field_m.can_place(ship_mask(ship_len, x, y, orientation))) {
+						field_m.place(ship_mask(ship_len, x, y, orientation));
 						goto ship_exit;
 					} else {
 					}
@@ -501,213 +339,295 @@ struct LocalPlayer : AbstractPlayer {
 		return;
 	}
 
-	WINDOW* field1;
-	WINDOW* field2;
-	WINDOW* shadow1;
-	WINDOW* shadow2;
+	GameScreen screen;
+	OnResize resize;
 };
 
-struct EasyPlayer : AbstractPlayer {
-	EasyPlayer() : rng(dev()) {}
+// the games played here go to this file, the Replay menu shows them
+static const char* records_path() {
+	const char* env = getenv("BATTLESHIP_RECORDS");
+	return env != nullptr && *env != '\0' ? env : "games.rec";
+}
 
-	virtual void arrange_ships() override {
-		for (int i = 0; i < 10; i++) {
-			for (int j = 0; j < 10; j++) {
-				field_m[i][j] = 0;
-				other_field_m[i][j] = 0;
-			}
-		}
+// player1 is the one who shot first
+static void save_game(const AbstractPlayer &player1, const AbstractPlayer &player2, const MatchResult &res) {
+	std::vector<uint8_t> encoded;
+	if (encode_record(player1.field_m, player2.field_m, res.log, encoded)) {
+		RecordWriter(records_path()).write(encoded);
+	}
+}
 
-		int ship_num = 1;
-		for (int ship_len = 4; ship_len > 0; ship_len--) {
-			for (int i = 0; i < 5 - ship_len; i++) {
-				get_ship(ship_len, ship_num);
-				health_points[ship_num - 1] = ship_len;
-				ship_num++;
-			}
-		}
+// the calls of another player made on the worker thread, so that the
+// interface stays alive while a bot thinks or the opponent is waited for;
+// its fields are copied back after every call
+struct BackgroundPlayer : AbstractPlayer {
+	BackgroundPlayer(AbstractPlayer &player, const char* what) : player(player), what(what) {}
 
-		refresh();
+	virtual const char* name() const override {
+		return player.name();
+	}
+
+	virtual void arrange_ships() override {
+		run([&] { player.arrange_ships(); });
 	}
 
 	virtual Coord take_shot() override {
-		int zero_num = 0;
-		for (int i = 0; i < 10; i++) {
-			for (int j = 0; j < 10; j++) {
-				if (other_field_m[i][j] == 0) {
-					zero_num++;
-				}
-			}
-		}
-		int rand = distr(rng) % zero_num + 1;
-		zero_num = 0;
-		for (int i = 0; i < 10; i++) {
-			for (int j = 0; j < 10; j++) {
-				if (other_field_m[i][j] == 0) {
-					zero_num++;
-					if (zero_num == rand) {
-						return Coord{j, i};
-					}
-				}
-			}
-		}
+		Coord shot;
+		run([&] { shot = player.take_shot(); });
+		return shot;
 	}
 
 	virtual ShotRes get_shot(Coord xy) override {
-		if (field_m[xy.y][xy.x] < 1 || 10 < field_m[xy.y][xy.x]) {
-			return ShotRes::miss;
-		} else {
-			int ship_num = field_m[xy.y][xy.x];
-
-			health_points[ship_num - 1]--;
-
-			if (health_points[ship_num - 1] > 0) {
-				return ShotRes::hit;
-			} else {
-				alive_ships_num--;
-				if (alive_ships_num > 0) {
-					return ShotRes::sank;
-				} else {
-					return ShotRes::game_over;
-				}
-			}
-		}
+		ShotRes res;
+		run([&] { res = player.get_shot(xy); });
+		return res;
 	}
 
 	virtual void get_res(ShotRes res, Coord shot) override {
-		if (res == ShotRes::miss) {
-			other_field_m[shot.y][shot.x] = 12;
-		} else if (res == ShotRes::hit) {
-			other_field_m[shot.y][shot.x] = 13;
-		} else if (res == ShotRes::sank) {
-			other_field_m[shot.y][shot.x] = 13;
-		}
+		run([&] { player.get_res(res, shot); });
+	}
+
+	virtual void game_res(GameRes res) override {
+		run([&] { player.game_res(res); });
 	}
-  
-	virtual void game_res(GameRes res) override {}
 
 private:
-	bool occupied(int x, int y, int ship_len, int orientation) {
-		bool flag = false;
-		for (int i = 0; i < ship_len; i++) {
-			int xx = x;
-			int yy = y;
-			if (orientation == 0) {
-				xx += i;
-			} else {
-				yy += i;
-			}
-			if (field_m[yy][xx] != 0) {
-				flag = true;
-			}
-		}
-		return flag;
+	void run(const std::function<void()> &call) {
+		run_in_background(call, what);
+		field_m = player.field_m;
+		other_field_m = player.other_field_m;
 	}
 
-	bool in_range(int x) {
-		return (0 <= x && x < 10);
+	AbstractPlayer &player;
+	const char* what;
+};
+
+// the match against a bot, the bot thinks on the worker thread
+static void play_bot(AbstractPlayer &bot) {
+	LocalPlayer player1;
+	BackgroundPlayer player2(bot, "Thinking");
+
+	save_game(player1, player2, run_match(player1, player2));
+}
+
+void process_easy_g(GameState &state) {
+	EasyPlayer bot;
+	play_bot(bot);
+
+	state = main_m;
+}
+
+void process_middle_g(GameState &state) {
+	MiddlePlayer bot;
+	play_bot(bot);
+
+	state = main_m;
+}
+
+// set by load_hard_weights, Hard is the plain hard bot without them
+static bool tuned_hard = false;
+static Weights hard_weights;
+
+bool load_hard_weights(const char* path) {
+	tuned_hard = hard_weights.load(path);
+	return tuned_hard;
+}
+
+void process_hard_g(GameState &state) {
+	std::unique_ptr<HardPlayer> bot;
+	if (tuned_hard) {
+		bot = std::make_unique<WeightedPlayer>(std::random_device()(), hard_weights);
+	} else {
+		bot = std::make_unique<HardPlayer>();
 	}
+	// the endgame is solved exactly when that fits into a tenth of a second
+	bot->endgame.max_layouts = 500;
+	bot->endgame.threads = default_threads();
+	bot->endgame.budget_ms = 100;
+	play_bot(*bot);
+
+	state = main_m;
+}
 
-	void get_ship(int ship_len, int ship_num) {
+void play_online(Link &link) {
+	bool first = link.wait_start();
+	LocalPlayer player1;
+	NetworkPlayer opponent(link, player1);
+	BackgroundPlayer player2(opponent, "Waiting for the opponent");
+
+	MatchResult res = first ? run_match(player1, player2) : run_match(player2, player1);
+	if (!opponent.opponent_verified()) {
+		process_message("The opponent's ships don't match its answers");
+	} else if (first) {
+		save_game(player1, player2, res);
+	} else {
+		save_game(player2, player1, res);
+	}
+}
 
-		int neighbours[8][2] = {
-			{0, 1},
-			{0, -1},
-			{1, 0},
-			{-1, 0},
-			{1, 1},
-			{1, -1},
-			{-1, 1},
-			{-1, -1}
-		};
+void process_create_g(GameState &state) {
+	std::string host;
+	int port;
+	server_address(host, port);
+
+	try {
+		Link link(host, port);
+		uint16_t code = link.create_game();
+		print_message("Game code: " + std::to_string(code) + ", waiting for the opponent");
+		play_online(link);
+	} catch (const NetworkError &e) {
+		process_message(e.what());
+	}
 
-		int free_num = 0;
-		for (int i = 0; i < 10 - ship_len + 1; i++) {
-			for (int j = 0; j < 10 - ship_len + 1; j++) {
-				if (field_m[i][j] == 0 && !occupied(j, i, ship_len, 0)) {
-					free_num++;
-				} else if (field_m[i][j] == 0 && !occupied(j, i, ship_len, 1)) {
-					free_num++;
-				}
-			}
-		}
+	state = main_m;
+}
 
-		int rand = distr(rng) % free_num + 1;
-		int num = 0;
-		for (int i = 0; i < 10 - ship_len + 1; i++) {
-			for (int j = 0; j < 10 - ship_len + 1; j++) {
-				int orientation = -1;
-				if (field_m[i][j] == 0 && !occupied(j, i, ship_len, 0)) {
-					num++;
-					if (num == rand) {
-						orientation = 0;
-					}
-				} else if (field_m[i][j] == 0 && !occupied(j, i, ship_len, 1)) {
-					num++;
-					if (num == rand) {
-						orientation = 1;
-					}
-				}
-				if (orientation != -1) {
-					for (int k = 0; k < ship_len; k++) {
-						int x = j + k * (1 - orientation);
-						int y = i + k * orientation;
-						field_m[y][x] = ship_num;
-						for (int w = 0; w < 8; w++) {
-							int xx = x + neighbours[w][0];
-							int yy = y + neighbours[w][1];
-							if (in_range(xx) && in_range(yy) && field_m[yy][xx] == 0) {
-								field_m[yy][xx] = 11;
-							}
-						}
-					}
-				}
-			}
+void process_join_g(GameState &state) {
+	std::string host;
+	int port;
+	server_address(host, port);
+
+	// codes are 16 bits, a longer one would wrap around to another match
+	int code;
+	if (read_number("Game code:", code, 0xffff)) {
+		try {
+			Link link(host, port);
+			link.join_game(uint16_t(code));
+			play_online(link);
+		} catch (const NetworkError &e) {
+			process_message(e.what());
 		}
 	}
 
-	std::random_device dev;
-  std::mt19937 rng;
-  std::uniform_int_distribution<int> distr;
-};
+	state = main_m;
+}
 
-void process_g(AbstractPlayer &player1, AbstractPlayer &player2) {
-	player1.arrange_ships();
-	player2.arrange_ships();
-
-	int cur_player = 1;
-	ShotRes res;
-	Coord shot;
-
-	while (true) {
-		if (cur_player == 1) {
-			shot = player1.take_shot();
-			res = player2.get_shot(shot);
-			player1.get_res(res, shot);
-			if (res == ShotRes::game_over) {
-				player1.game_res(GameRes::win);
-				break;
+void process_watch_g(GameState &state) {
+	std::string host;
+	int port;
+	server_address(host, port);
+
+	int code;
+	if (!read_number("Game code:", code, 0xffff)) {
+		state = main_m;
+		return;
+	}
+
+	try {
+		Link link(host, port);
+		link.watch_game(uint16_t(code));
+
+		GameScreen screen;
+		MatchView view;
+		mvprintw(LINES - 1, 0, "Press F1 to exit");
+		wnoutrefresh(stdscr);
+
+		// the frames and the keys are checked in turns, a frame at a time
+		short colors[100];
+		int winner = -1;
+		int ch;
+		nodelay(stdscr, TRUE);
+		while (winner == -1 && (ch = getch()) != KEY_F(1)) {
+			bool changed = false;
+			if (ch == KEY_RESIZE) {
+				resized();
+				mvprintw(LINES - 1, 0, "Press F1 to exit");
+				wnoutrefresh(stdscr);
+				changed = true;
 			}
-		} else {
-			shot = player2.take_shot();
-			res = player1.get_shot(shot);
-			player2.get_res(res, shot);
-			if (res == ShotRes::game_over) {
-				player1.game_res(GameRes::loss);
-				break;
+			while (winner == -1 && link.wait(changed ? 0 : 50)) {
+				Frame frame = link.recv();
+				view.apply(frame);
+				if (frame.type == FrameType::over) {
+					winner = frame.cell;
+				}
+				changed = true;
+			}
+			if (changed) {
+				board_colors(view.fields[0], true, colors);
+				screen.view1.draw(colors);
+				board_colors(view.fields[1], true, colors);
+				screen.view2.draw(colors);
+				update_screen();
 			}
 		}
-		if (res == ShotRes::miss) {
-			cur_player = 3 - cur_player;
+		nodelay(stdscr, FALSE);
+
+		if (winner == 2) {
+			process_message("The match was abandoned");
+		} else if (winner != -1) {
+			process_message(winner == 0 ? "The left player won" : "The right player won");
 		}
+	} catch (const NetworkError &e) {
+		nodelay(stdscr, FALSE);
+		process_message(e.what());
 	}
-}
 
-void process_easy_g(GameState &state) {
-	LocalPlayer player1;
-	EasyPlayer player2;
-	
-	process_g(player1, player2);
+	state = main_m;
+}
 
+void process_replay_g(GameState &state) {
 	state = main_m;
+
+	RecordFile file;
+	std::vector<GameRecord> games;
+	if (file.open(records_path())) {
+		for (GameRecord game : file) {
+			games.push_back(game);
+		}
+	}
+	if (games.empty()) {
+		process_message("There are no recorded games yet");
+		return;
+	}
+
+	int game;
+	if (!read_number("Game 1-" + std::to_string(games.size()) + ":", game)) {
+		return;
+	}
+	Replay replay;
+	if (game < 1 || game > int(games.size()) || !replay.load(games[game - 1])) {
+		process_message("There is no such game");
+		return;
+	}
+
+	GameScreen screen;
+	int turn = 0;
+	short colors[100];
+	int ch;
+
+	do {
+		replay.seek(turn);
+		board_colors(replay.field(1), false, colors);
+		screen.view1.draw(colors);
+		board_colors(replay.field(2), false, colors);
+		screen.view2.draw(colors);
+
+		move(LINES - 1, 0);
+		clrtoeol();
+		printw("Shot %d of %d   left/right: one shot, up/down: 10 shots, F1: exit", turn, replay.shots());
+		wnoutrefresh(stdscr);
+		update_screen();
+
+		switch (ch = next_key()) {
+			case KEY_RIGHT:
+				turn = std::min(turn + 1, replay.shots());
+				break;
+			case KEY_LEFT:
+				turn = std::max(turn - 1, 0);
+				break;
+			case KEY_DOWN:
+				turn = std::min(turn + 10, replay.shots());
+				break;
+			case KEY_UP:
+				turn = std::max(turn - 10, 0);
+				break;
+			case KEY_HOME:
+				turn = 0;
+				break;
+			case KEY_END:
+				turn = replay.shots();
+				break;
+		}
+	} while (ch != KEY_F(1));
 }
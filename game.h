@@ -3,3 +3,21 @@
 #include "GameState.h"
 
 void process_easy_g(GameState &state);
+
+void process_middle_g(GameState &state);
+
+// the weights battleship-train wrote to the file make Hard the tuned bot;
+// false if the file is missing or broken, Hard stays the hard bot then
+bool load_hard_weights(const char* path);
+
+void process_hard_g(GameState &state);
+
+void process_create_g(GameState &state);
+
+void process_join_g(GameState &state);
+
+// follows a match on the server as a spectator
+void process_watch_g(GameState &state);
+
+// steps through a game saved by an earlier local or online game
+void process_replay_g(GameState &state);
@@ -0,0 +1,144 @@
+#include <ncurses.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "loop.h"
+#include "render.h"
+
+namespace {
+
+const int frame_ms = 1000 / frame_rate;
+
+OnResize* innermost = nullptr;
+
+// keys typed while the worker was busy, next_key returns them first
+std::deque<int> typed;
+
+// the thread the bots think on, one job at a time
+struct Worker {
+	Worker() : thread([this] { run(); }) {}
+
+	~Worker() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		wake.notify_one();
+		thread.join();
+	}
+
+	std::future<void> post(const std::function<void()> &job) {
+		std::packaged_task<void()> task(job);
+		std::future<void> done = task.get_future();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending = std::move(task);
+		}
+		wake.notify_one();
+		return done;
+	}
+
+private:
+	void run() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wake.wait(lock, [this] { return stop || pending.valid(); });
+			if (stop) {
+				return;
+			}
+			std::packaged_task<void()> task = std::move(pending);
+			lock.unlock();
+			task();
+			lock.lock();
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::packaged_task<void()> pending;
+	bool stop = false;
+	std::thread thread;
+};
+
+Worker &worker() {
+	static Worker w;
+	return w;
+}
+
+void show_thinking(const char* what, double seconds) {
+	static const char spinner[] = "|/-\\";
+	mvprintw(LINES - 1, 0, "%s %c %.1fs", what, spinner[int(seconds * 8) % 4], seconds);
+	clrtoeol();
+	wnoutrefresh(stdscr);
+	update_screen();
+}
+
+}
+
+OnResize::OnResize(std::function<void()> redraw) : redraw(std::move(redraw)), outer(innermost) {
+	innermost = this;
+}
+
+OnResize::~OnResize() {
+	innermost = outer;
+}
+
+void resized() {
+	std::vector<OnResize*> open;
+	for (OnResize* r = innermost; r != nullptr; r = r->outer) {
+		open.push_back(r);
+	}
+	for (auto r = open.rbegin(); r != open.rend(); ++r) {
+		(*r)->redraw();
+	}
+	update_screen();
+}
+
+int next_key() {
+	int ch;
+	if (!typed.empty()) {
+		ch = typed.front();
+		typed.pop_front();
+	} else {
+		ch = getch();
+	}
+	if (ch == KEY_RESIZE) {
+		resized();
+	}
+	return ch;
+}
+
+void run_in_background(const std::function<void()> &job, const char* what) {
+	std::future<void> done = worker().post(job);
+
+	// a quick turn doesn't flash the indicator
+	if (done.wait_for(std::chrono::milliseconds(frame_ms)) != std::future_status::ready) {
+		auto start = std::chrono::steady_clock::now();
+		timeout(frame_ms);
+		while (done.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			show_thinking(what, elapsed.count());
+
+			// wakes up on a key or after a frame
+			int ch = getch();
+			if (ch == KEY_RESIZE) {
+				resized();
+			} else if (ch != ERR) {
+				typed.push_back(ch);
+			}
+		}
+		timeout(-1);
+
+		move(LINES - 1, 0);
+		clrtoeol();
+		wnoutrefresh(stdscr);
+		update_screen();
+	}
+
+	// rethrows what the job threw
+	done.get();
+}
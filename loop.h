@@ -0,0 +1,39 @@
+#pragma once
+#include <functional>
+
+// The interface's event loop. Keys are read with a timeout of one frame,
+// so while a bot thinks on the worker thread the loop keeps drawing the
+// "thinking" indicator at a steady rate and takes the keys typed meanwhile
+// for later. A resized terminal is laid out again by the screens that are
+// open at the time.
+
+const int frame_rate = 30;
+
+// while alive, its redraw is called after the terminal is resized; all of
+// them are called, the one created first first
+struct OnResize {
+	explicit OnResize(std::function<void()> redraw);
+
+	~OnResize();
+
+	OnResize(const OnResize&) = delete;
+	OnResize& operator=(const OnResize&) = delete;
+
+private:
+	std::function<void()> redraw;
+	OnResize* outer;
+
+	friend void resized();
+};
+
+// lays the screens out again for the new size, for loops that read the
+// keys themselves; next_key calls it
+void resized();
+
+// waits for a key; KEY_RESIZE is returned too, after resized
+int next_key();
+
+// runs job on the AI worker thread and keeps the interface going until it's
+// done; if that takes longer than a frame, the bottom line shows what is
+// going on and for how long
+void run_in_background(const std::function<void()> &job, const char* what = "Thinking");
@@ -4,10 +4,23 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include "assets.h"
 #include "menu.h"
 #include "game.h"
+#include "metrics.h"
 
 int main() {
+	// BATTLESHIP_METRICS=file times the players' calls and the drawing
+	const char* metrics_path = getenv("BATTLESHIP_METRICS");
+	if (metrics_path != nullptr && *metrics_path != '\0') {
+		enable_metrics();
+	}
+	// BATTLESHIP_ASSETS=dir replaces the built in texts with its files
+	load_assets(getenv("BATTLESHIP_ASSETS"));
+	// BATTLESHIP_WEIGHTS=file (weights.txt if unset) gives Hard tuned weights
+	const char* weights_path = getenv("BATTLESHIP_WEIGHTS");
+	load_hard_weights(weights_path != nullptr && *weights_path != '\0' ? weights_path : "weights.txt");
+
   initscr();			
 	curs_set(0);
 	cbreak();
@@ -70,23 +83,27 @@ int main() {
 			case easy_g:
 				process_easy_g(state);
 				break;
-			case TODO_m:
-				process_TODO_m(state);
-				break;
-				/*
 			case middle_g:
-				process_middle(state);
+				process_middle_g(state);
 				break;
 			case hard_g:
-				process_hard(state);
+				process_hard_g(state);
 				break;
 			case create_g:
-				process_create(state);
+				process_create_g(state);
+				break;
+			case join_g:
+				process_join_g(state);
 				break;
-			case connect_g:
-				process_connect(state);
+			case watch_g:
+				process_watch_g(state);
+				break;
+			case replay_g:
+				process_replay_g(state);
+				break;
+			case TODO_m:
+				process_TODO_m(state);
 				break;
-				*/
 			case exit_g:
 				goto Exit;
 		}
@@ -95,5 +112,8 @@ int main() {
 Exit:
 	
 	endwin();
+	if (metrics_path != nullptr && *metrics_path != '\0' && !save_metrics(metrics_path)) {
+		fprintf(stderr, "can't write the metrics to %s\n", metrics_path);
+	}
   return 0;
 }
@@ -3,8 +3,9 @@
 #include <cstring>
 #include <string>
 #include <vector>
-#include <fstream>
 #include "GameState.h"
+#include "assets.h"
+#include "loop.h"
 
 const int title_len = 87;
 const int title_h = 7;
@@ -27,12 +28,7 @@ WINDOW* create_menu(int height, int width, bool with_title) {
 	int row, col;
 	getmaxyx(stdscr, row, col);
 
-	// clear the screen by filling it with spaces
-	for (int i = 0; i < row; i++) {
-		for (int j = 0; j < col; j++) {
-			mvprintw(i, j, " ");
-		}
-	}
+	erase();
 
 	if (with_title) {
 		print_centered_title(row, col, height);
@@ -45,9 +41,9 @@ WINDOW* create_menu(int height, int width, bool with_title) {
 	wbkgd(menu, COLOR_PAIR(2));
 	box(menu, 0, 0);
 
-	refresh();
-	wrefresh(shadow);
-	wrefresh(menu);
+	wnoutrefresh(stdscr);
+	wnoutrefresh(shadow);
+	wnoutrefresh(menu);
 	delwin(shadow);
 	return menu;
 }
@@ -75,7 +71,7 @@ int process_menu(std::vector<std::string> &items) {
 
 		wrefresh(selection_menu);
 
-		switch (ch = getch()) {
+		switch (ch = next_key()) {
 			case KEY_DOWN:
 				cur_item++;
 				cur_item %= item_number;
@@ -96,12 +92,14 @@ int process_menu(std::vector<std::string> &items) {
 void process_main_m(GameState &state) {
 	std::vector<std::string> items = {
 		"Play",
+		"Replay",
 		"Help",
 		"Exit"
 	};
 
-	GameState gStatus[4] = {
+	GameState gStatus[5] = {
 		play_m,
+		replay_g,
 		help_m,
 		exit_g,
 		main_m
@@ -141,8 +139,8 @@ void process_local_m(GameState &state) {
 
 	GameState gStatus[5] = {
 		easy_g,
-		TODO_m,
-		TODO_m,
+		middle_g,
+		hard_g,
 		play_m,
 		local_m
 	};
@@ -156,12 +154,14 @@ void process_online_m(GameState &state) {
 	std::vector<std::string> items = {
 		"Create game",
 		"Join game",
+		"Watch game",
 		"Back"
 	};
 
-	GameState gStatus[4] = {
-		TODO_m,
-		TODO_m,
+	GameState gStatus[5] = {
+		create_g,
+		join_g,
+		watch_g,
 		play_m,
 		online_m
 	};
@@ -198,39 +198,21 @@ void process_help_m(GameState &state) {
 	refresh();
 
 	int ch;
-	int cur_item = 0;
-
-	std::string line;
-	std::ifstream in("help.txt");
-	std::vector<std::string> rules_text;
+	const TextAsset &rules_text = asset(Asset::help);
+	size_t page_lines = height > 2 ? height - 2 : 0;
 
-	if (in.is_open()) {
-		while (std::getline(in, line)) {
-			rules_text.push_back(line);
-		}
-	}
-
-	in.close();
-	
 	int cur_page = 0;
-	int page_number = 1;
-	if (height != 2) {
-		page_number = (rules_text.size() + height - 3) / (height - 2);
-	}
+	int page_number = rules_text.pages(page_lines);
 
 	do {
-		for (int i = 0; i < height - 2; i++) {
-			if (cur_page * (height - 2) + i >= rules_text.size()) {
-				for (int j = 0; j < 50; j++) {
-					mvwprintw(rules_page, i + 1, j + 1, " ");
-				}
-			} else {
-				mvwprintw(rules_page, i + 1, 1, rules_text[cur_page * (height - 2) + i].c_str());
-			}
+		for (size_t i = 0; i < page_lines; i++) {
+			std::string_view line = rules_text.page_line(cur_page, i, page_lines);
+			mvwhline(rules_page, i + 1, 1, ' ', width - 2);
+			mvwprintw(rules_page, i + 1, 1, "%.*s", int(line.size()), line.data());
 		}
 		wrefresh(rules_page);
 
-		switch (ch = getch()) {
+		switch (ch = next_key()) {
 			case KEY_DOWN:
 				cur_page++;
 				cur_page %= page_number;
@@ -242,6 +224,71 @@ void process_help_m(GameState &state) {
 				delwin(rules_page);
 				state = main_m;
 				return;
+			case KEY_RESIZE:
+				// laid out again for the new size, from the first page
+				delwin(rules_page);
+				state = help_m;
+				return;
 		}
 	} while	(true);
 }
+
+void print_message(const std::string &text) {
+	int width = text.size() + 6;
+	WINDOW* message = create_menu(3, width, true);
+	mvwprintw(message, 1, 3, "%s", text.c_str());
+	wrefresh(message);
+	delwin(message);
+}
+
+void process_message(const std::string &text) {
+	do {
+		print_message(text);
+	} while (next_key() == KEY_RESIZE);
+}
+
+bool read_number(const std::string &prompt, int &number, int max) {
+	int width = prompt.size() + 12;
+	WINDOW* input = create_menu(3, width, true);
+
+	mvprintw(LINES - 1, 0, "Press F1 to cancel");
+	refresh();
+
+	std::string digits;
+	int ch;
+
+	do {
+		mvwprintw(input, 1, 3, "%s %-5s", prompt.c_str(), digits.c_str());
+		wrefresh(input);
+
+		switch (ch = next_key()) {
+			case KEY_BACKSPACE:
+			case 127:
+				if (!digits.empty()) {
+					digits.pop_back();
+				}
+				break;
+			case '\n':
+				if (!digits.empty()) {
+					delwin(input);
+					number = std::stoi(digits);
+					return true;
+				}
+				break;
+			case KEY_F(1):
+				delwin(input);
+				return false;
+			case KEY_RESIZE:
+				delwin(input);
+				input = create_menu(3, width, true);
+				mvprintw(LINES - 1, 0, "Press F1 to cancel");
+				refresh();
+				break;
+			default:
+				if ('0' <= ch && ch <= '9' && digits.size() < 5 && std::stoi(digits + char(ch)) <= max) {
+					digits.push_back(ch);
+				}
+				break;
+		}
+	} while (true);
+}
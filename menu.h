@@ -26,3 +26,12 @@ void process_online_m(GameState &state);
 void process_TODO_m(GameState &state);
 
 void process_help_m(GameState &state);
+
+void print_message(const std::string &text);
+
+// shows the text until a key is pressed
+void process_message(const std::string &text);
+
+// asks for a number of up to 5 digits and no more than max, digits that
+// would go past it aren't taken; false if cancelled
+bool read_number(const std::string &prompt, int &number, int max = 99999);
@@ -0,0 +1,309 @@
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "metrics.h"
+
+namespace {
+
+const char* call_names[calls_num] = {"arrange_ships", "take_shot", "get_shot", "get_res", "draw", "update"};
+
+// values below 8 ns get a bucket each, then every power of two from 8 ns
+// up to 2^41 ns is split into 8, the last bucket takes everything longer
+const int sub_bits = 3;
+const int sub_buckets = 1 << sub_bits;
+const int max_exponent = 41;
+const int buckets = (max_exponent - sub_bits + 1) * sub_buckets;
+
+int bucket_of(uint64_t ns) {
+	if (ns < uint64_t(sub_buckets)) {
+		return int(ns);
+	}
+	int e = 63 - __builtin_clzll(ns);
+	if (e >= max_exponent) {
+		return buckets - 1;
+	}
+	return (e - sub_bits + 1) * sub_buckets + int((ns >> (e - sub_bits)) & (sub_buckets - 1));
+}
+
+// the smallest value of the bucket
+uint64_t bucket_low(int b) {
+	if (b < sub_buckets) {
+		return b;
+	}
+	int e = b / sub_buckets + sub_bits - 1;
+	return uint64_t(sub_buckets + b % sub_buckets) << (e - sub_bits);
+}
+
+// the largest value of the bucket
+uint64_t bucket_high(int b) {
+	return b + 1 < buckets ? bucket_low(b + 1) - 1 : ~uint64_t(0);
+}
+
+// written by its thread only: plain loads and stores, no lock prefix
+struct Histogram {
+	std::atomic<uint64_t> counts[buckets] = {};
+	std::atomic<uint64_t> sum{0};
+	std::atomic<uint64_t> max{0};
+
+	void add(uint64_t ns) {
+		std::atomic<uint64_t> &c = counts[bucket_of(ns)];
+		c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		sum.store(sum.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+		if (ns > max.load(std::memory_order_relaxed)) {
+			max.store(ns, std::memory_order_relaxed);
+		}
+	}
+};
+
+// the players seen so far, added under the lock and compared by text,
+// since the same name may come from different string literals
+const int max_names = 32;
+std::atomic<const char*> names[max_names];
+std::atomic<int> names_num{0};
+
+// every pointer a name has come with and the name it is, looked up without
+// a lock; a new pointer takes the lock once to be resolved by text
+const int max_aliases = 128;
+
+struct Alias {
+	std::atomic<const char*> who{nullptr};
+	int name = -1;
+};
+
+Alias aliases[max_aliases];
+std::atomic<int> aliases_num{0};
+
+// one per thread, a thread that exits leaves its histograms to the next one
+struct ThreadMetrics {
+	std::atomic<Histogram*> series[calls_num * max_names] = {};
+	std::vector<std::unique_ptr<Histogram>> owned;
+};
+
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<ThreadMetrics>> all_threads;
+std::vector<ThreadMetrics*> free_threads;
+
+int name_index(const char* who) {
+	int n = aliases_num.load(std::memory_order_acquire);
+	for (int i = 0; i < n; i++) {
+		if (aliases[i].who.load(std::memory_order_relaxed) == who) {
+			return aliases[i].name;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	n = aliases_num.load(std::memory_order_relaxed);
+	for (int i = 0; i < n; i++) {
+		if (aliases[i].who.load(std::memory_order_relaxed) == who) {
+			return aliases[i].name;
+		}
+	}
+
+	int name = -1;
+	int known = names_num.load(std::memory_order_relaxed);
+	for (int i = 0; i < known && name == -1; i++) {
+		if (strcmp(names[i].load(std::memory_order_relaxed), who) == 0) {
+			name = i;
+		}
+	}
+	if (name == -1 && known < max_names) {
+		name = known;
+		names[known].store(who, std::memory_order_relaxed);
+		names_num.store(known + 1, std::memory_order_release);
+	}
+	// past max_aliases a pointer is resolved under the lock every time
+	if (n < max_aliases) {
+		aliases[n].name = name;
+		aliases[n].who.store(who, std::memory_order_relaxed);
+		aliases_num.store(n + 1, std::memory_order_release);
+	}
+	return name;
+}
+
+struct ThreadSlot {
+	ThreadMetrics* metrics = nullptr;
+
+	~ThreadSlot() {
+		if (metrics != nullptr) {
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			free_threads.push_back(metrics);
+		}
+	}
+
+	ThreadMetrics& get() {
+		if (metrics == nullptr) {
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			if (!free_threads.empty()) {
+				metrics = free_threads.back();
+				free_threads.pop_back();
+			} else {
+				all_threads.push_back(std::make_unique<ThreadMetrics>());
+				metrics = all_threads.back().get();
+			}
+		}
+		return *metrics;
+	}
+};
+
+thread_local ThreadSlot thread_slot;
+
+// the histograms of all threads added up
+struct Merged {
+	uint64_t counts[buckets];
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+
+	// the largest value of the bucket the q-th part of the calls fall into
+	uint64_t quantile(double q) const {
+		uint64_t rank = uint64_t(q * count + 0.5);
+		rank = rank < 1 ? 1 : rank;
+		uint64_t seen = 0;
+		for (int b = 0; b < buckets; b++) {
+			seen += counts[b];
+			if (seen >= rank) {
+				return bucket_high(b) < max ? bucket_high(b) : max;
+			}
+		}
+		return max;
+	}
+};
+
+struct Row {
+	int call;
+	const char* who;
+	Merged m;
+};
+
+std::vector<Row> merge_all() {
+	std::vector<Row> rows;
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	int n = names_num.load(std::memory_order_acquire);
+	for (int call = 0; call < calls_num; call++) {
+		for (int name = 0; name < n; name++) {
+			Row row{call, names[name].load(std::memory_order_relaxed), {}};
+			for (const std::unique_ptr<ThreadMetrics> &t : all_threads) {
+				Histogram* h = t->series[call * max_names + name].load(std::memory_order_acquire);
+				if (h == nullptr) {
+					continue;
+				}
+				for (int b = 0; b < buckets; b++) {
+					uint64_t c = h->counts[b].load(std::memory_order_relaxed);
+					row.m.counts[b] += c;
+					row.m.count += c;
+				}
+				row.m.sum += h->sum.load(std::memory_order_relaxed);
+				uint64_t max = h->max.load(std::memory_order_relaxed);
+				row.m.max = max > row.m.max ? max : row.m.max;
+			}
+			if (row.m.count != 0) {
+				rows.push_back(row);
+			}
+		}
+	}
+	return rows;
+}
+
+void append(std::string &out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+void append(std::string &out, const char* format, ...) {
+	char buf[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buf, sizeof buf, format, args);
+	va_end(args);
+	out += buf;
+}
+
+}
+
+void enable_metrics() {
+	metrics_on.store(true, std::memory_order_relaxed);
+}
+
+void record_call(Call call, const char* who, uint64_t ns) {
+	int name = name_index(who);
+	if (name == -1) {
+		return;
+	}
+	ThreadMetrics &t = thread_slot.get();
+	std::atomic<Histogram*> &slot = t.series[int(call) * max_names + name];
+	Histogram* h = slot.load(std::memory_order_relaxed);
+	if (h == nullptr) {
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		t.owned.push_back(std::make_unique<Histogram>());
+		h = t.owned.back().get();
+		slot.store(h, std::memory_order_release);
+	}
+	h->add(ns);
+}
+
+std::string metrics_prometheus() {
+	std::string out;
+	out += "# HELP battleship_call_seconds Time spent in a player's call or in drawing the game.\n";
+	out += "# TYPE battleship_call_seconds histogram\n";
+	for (const Row &row : merge_all()) {
+		const char* call = call_names[row.call];
+		uint64_t cumulative = 0;
+		for (int b = 0; b < buckets; b++) {
+			if (row.m.counts[b] == 0) {
+				continue;
+			}
+			cumulative += row.m.counts[b];
+			// le is inclusive: the bucket holds whole nanoseconds up to its high end
+			append(out, "battleship_call_seconds_bucket{call=\"%s\",player=\"%s\",le=\"%.9g\"} %llu\n",
+				call, row.who, bucket_high(b) * 1e-9, (unsigned long long)cumulative);
+		}
+		append(out, "battleship_call_seconds_bucket{call=\"%s\",player=\"%s\",le=\"+Inf\"} %llu\n",
+			call, row.who, (unsigned long long)row.m.count);
+		append(out, "battleship_call_seconds_sum{call=\"%s\",player=\"%s\"} %.9g\n",
+			call, row.who, row.m.sum * 1e-9);
+		append(out, "battleship_call_seconds_count{call=\"%s\",player=\"%s\"} %llu\n",
+			call, row.who, (unsigned long long)row.m.count);
+	}
+	return out;
+}
+
+std::string metrics_json() {
+	std::string out = "{\"calls\": [";
+	bool first = true;
+	for (const Row &row : merge_all()) {
+		const Merged &m = row.m;
+		append(out, "%s\n  {\"call\": \"%s\", \"player\": \"%s\", \"count\": %llu, \"mean_ns\": %.1f,",
+			first ? "" : ",", call_names[row.call], row.who, (unsigned long long)m.count, double(m.sum) / m.count);
+		append(out, " \"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu,",
+			(unsigned long long)m.quantile(0.5), (unsigned long long)m.quantile(0.9),
+			(unsigned long long)m.quantile(0.99), (unsigned long long)m.quantile(0.999),
+			(unsigned long long)m.max);
+		// [low, high, count] of every bucket that got calls
+		out += " \"buckets\": [";
+		bool first_bucket = true;
+		for (int b = 0; b < buckets; b++) {
+			if (m.counts[b] != 0) {
+				append(out, "%s[%llu, %llu, %llu]", first_bucket ? "" : ", ", (unsigned long long)bucket_low(b),
+					(unsigned long long)bucket_high(b), (unsigned long long)m.counts[b]);
+				first_bucket = false;
+			}
+		}
+		out += "]}";
+		first = false;
+	}
+	out += "\n]}\n";
+	return out;
+}
+
+bool save_metrics(const char* path) {
+	size_t len = strlen(path);
+	bool json = len >= 5 && strcmp(path + len - 5, ".json") == 0;
+	std::string text = json ? metrics_json() : metrics_prometheus();
+
+	FILE* f = fopen(path, "w");
+	if (f == nullptr) {
+		return false;
+	}
+	bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+	return fclose(f) == 0 && ok;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Latency histograms of the players' calls and of drawing the game.
+// Every thread records into its own histograms without locks or atomic
+// read-modify-writes, the dumps merge the threads when asked. Buckets are
+// log-linear as in HdrHistogram: 8 per power of two, so a bucket is at
+// most 12.5% wide, from 1 ns to about 37 minutes.
+
+enum class Call {
+	arrange_ships,
+	take_shot,
+	get_shot,
+	get_res,
+	draw, // BoardView::draw, staging the changed cells
+	update // doupdate, writing the frame to the terminal
+};
+
+constexpr int calls_num = 6;
+
+inline std::atomic<bool> metrics_on{false};
+
+// recording is off until this is called
+void enable_metrics();
+
+inline bool metrics_enabled() {
+	return metrics_on.load(std::memory_order_relaxed);
+}
+
+inline uint64_t now_ns() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// adds a call that took ns nanoseconds; who is the player's name() or
+// "screen", it must live as long as the program (a string literal)
+void record_call(Call call, const char* who, uint64_t ns);
+
+// records the time from its construction to its destruction, if the
+// metrics were on when it was constructed
+struct CallTimer {
+	CallTimer(Call call, const char* who) : call(call), who(who), start(metrics_enabled() ? now_ns() : 0) {}
+
+	~CallTimer() {
+		if (start != 0) {
+			record_call(call, who, now_ns() - start);
+		}
+	}
+
+	CallTimer(const CallTimer&) = delete;
+	CallTimer& operator=(const CallTimer&) = delete;
+
+private:
+	Call call;
+	const char* who;
+	uint64_t start;
+};
+
+// Prometheus text exposition: one histogram battleship_call_seconds with
+// the labels call and player, only the buckets that got calls are listed
+std::string metrics_prometheus();
+
+// per call and player: count, mean, percentiles and the buckets, in ns
+std::string metrics_json();
+
+// writes metrics_json if the path ends with .json, else metrics_prometheus
+bool save_metrics(const char* path);
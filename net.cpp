@@ -0,0 +1,286 @@
+#include <cstdlib>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <random>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "net.h"
+#include "placement.h"
+
+Link::Link(const std::string &host, int port) {
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	addrinfo* res;
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) {
+		throw NetworkError("can't resolve " + host);
+	}
+
+	fd = -1;
+	for (addrinfo* ai = res; ai != nullptr && fd < 0; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(res);
+
+	if (fd < 0) {
+		throw NetworkError("can't connect to " + host + ":" + std::to_string(port));
+	}
+
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+Link::~Link() {
+	if (!out.empty()) {
+		::send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+	}
+	close(fd);
+}
+
+void Link::send(const Frame &frame) {
+	size_t size = out.size();
+	out.resize(size + frame_size);
+	encode(frame, out.data() + size);
+}
+
+void Link::flush() {
+	size_t sent = 0;
+	while (sent < out.size()) {
+		ssize_t n = ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+		if (n <= 0) {
+			throw NetworkError("connection lost");
+		}
+		sent += n;
+	}
+	out.clear();
+}
+
+Frame Link::recv() {
+	flush();
+	while (buf_end - buf_begin < frame_size) {
+		if (buf_begin > 0) {
+			memmove(buf, buf + buf_begin, buf_end - buf_begin);
+			buf_end -= buf_begin;
+			buf_begin = 0;
+		}
+		ssize_t n = ::recv(fd, buf + buf_end, sizeof(buf) - buf_end, 0);
+		if (n <= 0) {
+			throw NetworkError("connection lost");
+		}
+		buf_end += n;
+	}
+
+	Frame frame;
+	if (!decode(buf + buf_begin, frame)) {
+		throw NetworkError("bad frame from the server");
+	}
+	buf_begin += frame_size;
+
+	if (frame.type == FrameType::left) {
+		throw NetworkError("the opponent has left");
+	} else if (frame.type == FrameType::error) {
+		switch (NetError(frame.value)) {
+			case NetError::no_such_match:
+				throw NetworkError("there is no game with this code");
+			case NetError::lobby_full:
+				throw NetworkError("the server is full");
+			default:
+				throw NetworkError("the server rejected the request");
+		}
+	}
+	return frame;
+}
+
+uint16_t Link::create_game() {
+	send(Frame{FrameType::create});
+	Frame frame = recv();
+	if (frame.type != FrameType::created) {
+		throw NetworkError("unexpected answer from the server");
+	}
+	return frame.value;
+}
+
+void Link::join_game(uint16_t code) {
+	send(Frame{FrameType::join, 0, ShotRes::hit, code});
+}
+
+bool Link::wait_start() {
+	Frame frame = recv();
+	if (frame.type != FrameType::start) {
+		throw NetworkError("unexpected answer from the server");
+	}
+	return frame.cell == 1;
+}
+
+void Link::watch_game(uint16_t code) {
+	send(Frame{FrameType::watch, 0, ShotRes::hit, code});
+	flush();
+}
+
+bool Link::wait(int timeout_ms) {
+	if (buf_end - buf_begin >= frame_size) {
+		return true;
+	}
+	flush();
+	pollfd p = {fd, POLLIN, 0};
+	return ::poll(&p, 1, timeout_ms) > 0;
+}
+
+void server_address(std::string &host, int &port) {
+	host = "127.0.0.1";
+	port = 7777;
+
+	const char* env = getenv("BATTLESHIP_SERVER");
+	if (env == nullptr || *env == '\0') {
+		return;
+	}
+
+	const char* colon = strrchr(env, ':');
+	if (colon == nullptr) {
+		host = env;
+	} else {
+		host = std::string(env, colon - env);
+		port = atoi(colon + 1);
+	}
+}
+
+void NetworkPlayer::commit() {
+	if (committed) {
+		return;
+	}
+	committed = true;
+	std::random_device device;
+	nonce = uint64_t(device()) << 32 | device();
+	Commitment c = layout_commitment(local.field_m.ships, nonce);
+	for (int part = 0; part < commit_parts; part++) {
+		link.send(Frame{FrameType::commit, uint8_t(part), ShotRes::hit, c.parts[part]});
+	}
+}
+
+Frame NetworkPlayer::next() {
+	commit();
+	while (true) {
+		Frame frame = link.recv();
+		if (frame.type != FrameType::commit) {
+			return frame;
+		}
+		theirs.parts[frame.cell] = frame.value;
+		their_parts |= 1 << frame.cell;
+	}
+}
+
+Frame NetworkPlayer::expect(FrameType type) {
+	Frame frame = next();
+	if (frame.type != type) {
+		throw NetworkError("the opponent broke the turn order");
+	}
+	return frame;
+}
+
+Coord NetworkPlayer::take_shot() {
+	Coord shot = frame_coord(expect(FrameType::shot));
+	// a hit answers a repeated shot again, the opponent would keep the turn forever
+	if (local.field_m.shot().test(shot.x, shot.y)) {
+		throw NetworkError("the opponent shot at the same cell twice");
+	}
+	return shot;
+}
+
+ShotRes NetworkPlayer::get_shot(Coord xy) {
+	commit();
+	link.send(shot_frame(xy));
+	ShotRes res = expect(FrameType::result).res;
+	answers.push_back(Answer{xy, res});
+	return res;
+}
+
+void NetworkPlayer::get_res(ShotRes res, Coord shot) {
+	commit();
+	link.send(result_frame(shot, res));
+}
+
+void NetworkPlayer::game_res(GameRes res) {
+	commit();
+	Bitboard ships = local.field_m.ships;
+	link.send(Frame{FrameType::over, uint8_t(res == GameRes::loss), ShotRes::hit, 0});
+	for (int part = 0; part < reveal_parts; part++) {
+		link.send(Frame{FrameType::reveal, uint8_t(part), ShotRes::hit, reveal_part(ships, part)});
+	}
+	for (int part = 0; part < nonce_parts; part++) {
+		uint16_t bits = uint16_t(nonce >> (16 * part));
+		link.send(Frame{FrameType::reveal, uint8_t(reveal_parts + part), ShotRes::hit, bits});
+	}
+
+	Frame over = expect(FrameType::over);
+	Bitboard layout;
+	uint64_t their_nonce = 0;
+	for (int i = 0; i < reveal_parts + nonce_parts; i++) {
+		Frame frame = expect(FrameType::reveal);
+		if (frame.cell < reveal_parts) {
+			add_reveal_part(layout, frame.cell, frame.value);
+		} else {
+			their_nonce |= uint64_t(frame.value) << (16 * (frame.cell - reveal_parts));
+		}
+	}
+	link.flush();
+
+	verified = their_parts == (1 << commit_parts) - 1 && layout_commitment(layout, their_nonce) == theirs
+		&& (over.cell == 1) == (res == GameRes::win) && check(layout);
+}
+
+// splits the layout into ships, checks that they make up the fleet and
+// don't touch, then replays our shots against it
+bool NetworkPlayer::check(Bitboard layout) {
+	if ((layout.hi & ~Bitboard::hi_mask) != 0) {
+		return false;
+	}
+
+	Board board;
+	board.clear();
+	int count[5] = {};
+	for (Bitboard rest = layout; rest.any(); ) {
+		int i = rest.lowest();
+		Bitboard ship = Bitboard::bit(i);
+		Bitboard grown = dilate4(ship) & layout;
+		while (grown != ship) {
+			ship = grown;
+			grown = dilate4(ship) & layout;
+		}
+		rest = rest & ~ship;
+
+		int ship_len = ship.count();
+		int x = i % 10;
+		int y = i / 10;
+		if (ship_len > 4 || board.ship_num == fleet_size || !board.can_place(ship)) {
+			return false;
+		}
+		bool horizontal = x + ship_len <= 10 && ship == ship_mask(ship_len, x, y, 0);
+		bool vertical = y + ship_len <= 10 && ship == ship_mask(ship_len, x, y, 1);
+		if (!horizontal && !vertical) {
+			return false;
+		}
+		count[ship_len]++;
+		board.place(ship);
+	}
+	for (int ship_len = 1; ship_len < 5; ship_len++) {
+		if (count[ship_len] != 5 - ship_len) {
+			return false;
+		}
+	}
+
+	for (const Answer &answer : answers) {
+		if (board.shoot(answer.shot) != answer.res) {
+			return false;
+		}
+	}
+	field_m = board;
+	return true;
+}
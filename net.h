@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "player.h"
+#include "protocol.h"
+
+struct NetworkError : std::runtime_error {
+	using std::runtime_error::runtime_error;
+};
+
+// blocking frame connection to the server, throws NetworkError on failure;
+// sent frames wait in a buffer and go out together in one write when the
+// link is about to block on recv, on flush or when it is destroyed
+struct Link {
+	Link(const std::string &host, int port);
+
+	~Link();
+
+	Link(const Link&) = delete;
+	Link& operator=(const Link&) = delete;
+
+	void send(const Frame &frame);
+
+	void flush();
+
+	Frame recv();
+
+	// asks the server to host a match, returns its code
+	uint16_t create_game();
+
+	// joins the match with the code
+	void join_game(uint16_t code);
+
+	// waits until both players are in, true if this side shoots first
+	bool wait_start();
+
+	// follows the match with the code, recv returns its board, move and over frames
+	void watch_game(uint16_t code);
+
+	// true if recv won't block, waits for up to timeout_ms for that
+	bool wait(int timeout_ms);
+
+private:
+	int fd;
+	std::vector<uint8_t> out;
+	uint8_t buf[256];
+	size_t buf_begin = 0;
+	size_t buf_end = 0;
+};
+
+// host:port from BATTLESHIP_SERVER, 127.0.0.1:7777 by default
+void server_address(std::string &host, int &port);
+
+// the opponent on the other side of a link; its own field is never
+// known here, shots at it are sent to the server and answered remotely.
+// Before its first frame each side commits to its layout with a random
+// nonce and reveals both after the game, so a client that answered shots
+// dishonestly is caught by the other side's opponent_verified()
+struct NetworkPlayer : AbstractPlayer {
+	// local is the player on this side, its layout is what gets committed
+	NetworkPlayer(Link &link, const AbstractPlayer &local) : link(link), local(local) {}
+
+	virtual const char* name() const override {
+		return "network";
+	}
+
+	virtual void arrange_ships() override {}
+
+	// the opponent's shot; a cell it has shot at before breaks the protocol
+	virtual Coord take_shot() override;
+
+	// our shot, waits for the opponent's answer
+	virtual ShotRes get_shot(Coord xy) override;
+
+	// our answer to the opponent's shot
+	virtual void get_res(ShotRes res, Coord shot) override;
+
+	// exchanges the layouts and checks the opponent's one
+	virtual void game_res(GameRes res) override;
+
+	// true once the game is over and the opponent's revealed layout and
+	// nonce match its commitment and the layout is a legal fleet that
+	// matches all of its answers;
+	// field_m then holds that fleet
+	bool opponent_verified() const {
+		return verified;
+	}
+
+private:
+	struct Answer {
+		Coord shot;
+		ShotRes res;
+	};
+
+	void commit();
+
+	// the next frame that isn't a part of the opponent's commitment
+	Frame next();
+
+	Frame expect(FrameType type);
+
+	bool check(Bitboard layout);
+
+	Link &link;
+	const AbstractPlayer &local;
+	bool committed = false;
+	bool verified = false;
+	uint64_t nonce = 0;
+	Commitment theirs;
+	int their_parts = 0;
+	std::vector<Answer> answers;
+};
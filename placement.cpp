@@ -0,0 +1,68 @@
+#include "placement.h"
+
+namespace {
+
+// cells where a ship of the given length can start, by orientation
+struct Anchors {
+	Bitboard cells[5][2];
+};
+
+constexpr Anchors make_anchors() {
+	Anchors a{};
+	for (int ship_len = 1; ship_len < 5; ship_len++) {
+		for (int y = 0; y < 10; y++) {
+			for (int x = 0; x < 10; x++) {
+				if (x + ship_len <= 10) {
+					a.cells[ship_len][0] |= Bitboard::cell(x, y);
+				}
+				if (y + ship_len <= 10) {
+					a.cells[ship_len][1] |= Bitboard::cell(x, y);
+				}
+			}
+		}
+	}
+	return a;
+}
+
+constexpr Anchors anchors = make_anchors();
+
+}
+
+bool sample_ships(Rng &rng, Bitboard taken, const int* lens, int count, Bitboard* ships) {
+	for (int s = 0; s < count; s++) {
+		int ship_len = lens[s];
+		Bitboard free = ~taken;
+
+		// a ship fits at a cell if the cell and the next ship_len - 1 ones are free
+		Bitboard horizontal = free & anchors.cells[ship_len][0];
+		Bitboard vertical = free & anchors.cells[ship_len][1];
+		for (int k = 1; k < ship_len; k++) {
+			horizontal &= free.shr(k);
+			vertical &= free.shr(10 * k);
+		}
+		if (ship_len == 1) {
+			vertical = Bitboard();
+		}
+
+		int h_num = horizontal.count();
+		int num = h_num + vertical.count();
+		if (num == 0) {
+			return false;
+		}
+
+		int r = rng.below(num);
+		int index = r < h_num ? placement_index(ship_len, horizontal.nth(r), 0)
+			: placement_index(ship_len, vertical.nth(r - h_num), 1);
+
+		const Placement &p = placement_table.p[index];
+		ships[s] = p.ship;
+		taken |= p.ship | p.halo;
+	}
+	return true;
+}
+
+void random_fleet(Rng &rng, Bitboard* ships) {
+	// a bad start can leave no room for the last ships, then start over
+	while (!sample_ships(rng, Bitboard(), fleet_lens, fleet_size, ships)) {
+	}
+}
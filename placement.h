@@ -0,0 +1,79 @@
+#pragma once
+#include "board.h"
+#include "rng.h"
+
+// the fleet in the order it's arranged
+constexpr int fleet_size = 10;
+constexpr int fleet_lens[fleet_size] = {4, 3, 3, 2, 2, 2, 1, 1, 1, 1};
+
+struct Placement {
+	Bitboard ship;
+	Bitboard halo;
+};
+
+// positions of a ship of every length: horizontal ones row by row, then
+// vertical ones (none for a single cell ship, it's the same both ways)
+constexpr int placement_offset[6] = {0, 0, 100, 280, 440, 580};
+
+struct PlacementTable {
+	Placement p[580];
+};
+
+constexpr PlacementTable make_placement_table() {
+	PlacementTable table{};
+	for (int ship_len = 1; ship_len < 5; ship_len++) {
+		int k = placement_offset[ship_len];
+		int orientations = ship_len == 1 ? 1 : 2;
+		for (int orientation = 0; orientation < orientations; orientation++) {
+			for (int y = 0; y < 10 - orientation * (ship_len - 1); y++) {
+				for (int x = 0; x < 10 - (1 - orientation) * (ship_len - 1); x++) {
+					Bitboard ship = ship_mask(ship_len, x, y, orientation);
+					table.p[k++] = Placement{ship, halo(ship)};
+				}
+			}
+		}
+	}
+	return table;
+}
+
+inline constexpr PlacementTable placement_table = make_placement_table();
+
+struct PlacementRange {
+	const Placement* first;
+	const Placement* last;
+
+	const Placement* begin() const {
+		return first;
+	}
+
+	const Placement* end() const {
+		return last;
+	}
+};
+
+// every position of a ship of the given length (1..4) on an empty field
+inline PlacementRange placements(int ship_len) {
+	return PlacementRange{placement_table.p + placement_offset[ship_len],
+		placement_table.p + placement_offset[ship_len + 1]};
+}
+
+// where in the table the ship of the given length starting at the cell
+// lies, orientation 0 horizontal, 1 vertical
+constexpr int placement_index(int ship_len, int cell, int orientation) {
+	return orientation == 0 ? placement_offset[ship_len] + cell / 10 * (11 - ship_len) + cell % 10
+		: placement_offset[ship_len] + 10 * (11 - ship_len) + cell;
+}
+
+// puts ships of the given lengths one by one at random cells, each ship
+// uniformly among the positions left legal by `taken` and the ships before
+// it; returns false if some ship found no room. The layouts are not
+// uniform as a whole: one whose first ships leave the later ones little
+// room comes up more often than one that leaves them much. Uniform layouts
+// by rejection keep about 3 draws of 10000 for the classic fleet, far too
+// slow for the Monte-Carlo bot, which samples with this and leans the same way
+bool sample_ships(Rng &rng, Bitboard taken, const int* lens, int count, Bitboard* ships);
+
+// a random arrangement of the whole fleet, ships in fleet_lens order, drawn
+// by sample_ships; a dead end starts it over, though longest first the
+// classic fleet hits none in a million draws
+void random_fleet(Rng &rng, Bitboard* ships);
@@ -0,0 +1,24 @@
+#pragma once
+#include "board.h"
+
+struct AbstractPlayer {
+	virtual ~AbstractPlayer() = default;
+
+	virtual void arrange_ships() = 0;
+
+	virtual Coord take_shot() = 0;
+
+	virtual ShotRes get_shot(Coord) = 0;
+
+	virtual void get_res(ShotRes, Coord) = 0;
+
+	virtual void game_res(GameRes) = 0;
+
+	// what kind of player this is, the metrics are kept by it
+	virtual const char* name() const {
+		return "player";
+	}
+
+	Board field_m;
+	Board other_field_m;
+};
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "pool.h"
+
+namespace {
+
+// [next, end) of one worker packed as next << 32 | end, so that the owner
+// taking a chunk and a thief cutting the tail are both a single CAS
+struct alignas(64) Slot {
+	std::atomic<uint64_t> range;
+};
+
+uint64_t pack(uint64_t next, uint64_t end) {
+	return next << 32 | end;
+}
+
+void run_worker(int w, int threads, uint64_t chunk, Slot* slots,
+		const std::function<void(int, uint64_t, uint64_t)> &body) {
+	while (true) {
+		uint64_t r = slots[w].range.load(std::memory_order_acquire);
+		uint64_t next = r >> 32;
+		uint64_t end = r & 0xffffffff;
+
+		if (next < end) {
+			uint64_t take = std::min(chunk, end - next);
+			if (slots[w].range.compare_exchange_weak(r, pack(next + take, end),
+					std::memory_order_acq_rel)) {
+				body(w, next, next + take);
+			}
+			continue;
+		}
+
+		bool stolen = false;
+		for (int k = 1; k < threads && !stolen; k++) {
+			Slot &victim = slots[(w + k) % threads];
+			uint64_t v = victim.range.load(std::memory_order_acquire);
+			uint64_t v_next = v >> 32;
+			uint64_t v_end = v & 0xffffffff;
+			if (v_next >= v_end) {
+				continue;
+			}
+			uint64_t steal = (v_end - v_next + 1) / 2;
+			if (victim.range.compare_exchange_strong(v, pack(v_next, v_end - steal),
+					std::memory_order_acq_rel)) {
+				slots[w].range.store(pack(v_end - steal, v_end), std::memory_order_release);
+				stolen = true;
+			}
+		}
+
+		if (!stolen) {
+			return;
+		}
+	}
+}
+
+}
+
+int default_threads() {
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void parallel_for(uint64_t n, int threads, uint64_t chunk,
+		const std::function<void(int, uint64_t, uint64_t)> &body) {
+	threads = std::max(1, threads);
+	chunk = std::max<uint64_t>(1, chunk);
+
+	std::unique_ptr<Slot[]> slots(new Slot[threads]);
+	for (int w = 0; w < threads; w++) {
+		slots[w].range.store(pack(n * w / threads, n * (w + 1) / threads));
+	}
+
+	std::vector<std::thread> workers;
+	for (int w = 1; w < threads; w++) {
+		workers.emplace_back(run_worker, w, threads, chunk, slots.get(), std::cref(body));
+	}
+	run_worker(0, threads, chunk, slots.get(), body);
+
+	for (std::thread &t : workers) {
+		t.join();
+	}
+}
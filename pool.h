@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+// number of hardware threads, at least 1
+int default_threads();
+
+// runs body(worker, begin, end) over [0, n) on the given number of threads;
+// every worker starts with an equal slice and takes it chunk by chunk, a
+// worker left without work steals half of what remains of another one.
+// n must fit into 32 bits
+void parallel_for(uint64_t n, int threads, uint64_t chunk,
+		const std::function<void(int, uint64_t, uint64_t)> &body);
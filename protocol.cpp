@@ -0,0 +1,104 @@
+#include "protocol.h"
+#include "sha256.h"
+
+void encode(const Frame &frame, uint8_t* out) {
+	out[0] = uint8_t(uint8_t(frame.type) << 4 | uint8_t(frame.res));
+	out[1] = frame.cell;
+	out[2] = uint8_t(frame.value);
+	out[3] = uint8_t(frame.value >> 8);
+}
+
+namespace {
+
+// the last part of a layout only has the bits of cells 96..99, the rest
+// would put ships past the field where no shot can reach them
+bool off_field(int part, uint16_t bits) {
+	return (bits & ~reveal_part(Bitboard::full(), part)) != 0;
+}
+
+}
+
+bool decode(const uint8_t* in, Frame &frame) {
+	int type = in[0] >> 4;
+	if (type < int(FrameType::create) || type > int(FrameType::board) || (in[0] & 0x0c) != 0) {
+		return false;
+	}
+
+	frame.type = FrameType(type);
+	frame.res = ShotRes(in[0] & 3);
+	frame.cell = in[1];
+	frame.value = uint16_t(in[2] | in[3] << 8);
+
+	if ((frame.type == FrameType::shot || frame.type == FrameType::result) && frame.cell >= 100) {
+		return false;
+	} else if (frame.type == FrameType::move && (frame.cell >= 100 || frame.value > 1)) {
+		return false;
+	} else if (frame.type == FrameType::board && (frame.cell >= 2 * board_planes * reveal_parts
+			|| off_field(frame.cell % reveal_parts, frame.value))) {
+		return false;
+	} else if (frame.type == FrameType::commit && frame.cell >= commit_parts) {
+		return false;
+	} else if (frame.type == FrameType::reveal && (frame.cell >= reveal_parts + nonce_parts
+			|| (frame.cell < reveal_parts && off_field(frame.cell, frame.value)))) {
+		return false;
+	}
+	return true;
+}
+
+Commitment layout_commitment(Bitboard ships, uint64_t nonce) {
+	uint64_t words[3] = {nonce, ships.lo, ships.hi};
+	uint8_t bytes[24];
+	for (int i = 0; i < 24; i++) {
+		bytes[i] = uint8_t(words[i / 8] >> (8 * (i % 8)));
+	}
+	uint8_t digest[sha256_size];
+	sha256(bytes, sizeof(bytes), digest);
+
+	Commitment c;
+	for (int part = 0; part < commit_parts; part++) {
+		c.parts[part] = uint16_t(digest[2 * part] | digest[2 * part + 1] << 8);
+	}
+	return c;
+}
+
+uint16_t reveal_part(Bitboard ships, int part) {
+	return uint16_t(part < 4 ? ships.lo >> (16 * part) : ships.hi >> (16 * (part - 4)));
+}
+
+void add_reveal_part(Bitboard &ships, int part, uint16_t bits) {
+	if (part < 4) {
+		ships.lo |= uint64_t(bits) << (16 * part);
+	} else {
+		ships.hi |= uint64_t(bits) << (16 * (part - 4));
+	}
+}
+
+void MatchView::apply(const Frame &frame) {
+	if (frame.type == FrameType::move) {
+		Board &field = fields[1 - frame.value];
+		Coord xy = frame_coord(frame);
+		field.record(frame.res, xy);
+		if (frame.res == ShotRes::sank || frame.res == ShotRes::game_over) {
+			field.mark_sunk(xy);
+		}
+	} else if (frame.type == FrameType::board) {
+		int part = frame.cell % reveal_parts;
+		int plane = frame.cell / reveal_parts % board_planes;
+		Board &field = fields[frame.cell / reveal_parts / board_planes];
+		switch (Plane(plane)) {
+			case Plane::misses:
+				add_reveal_part(field.misses, part, frame.value);
+				break;
+			case Plane::hits:
+				add_reveal_part(field.hits, part, frame.value);
+				break;
+			case Plane::sunk:
+				add_reveal_part(field.sunk, part, frame.value);
+				field.halo = halo(field.sunk);
+				break;
+			case Plane::ships:
+				add_reveal_part(field.ships, part, frame.value);
+				break;
+		}
+	}
+}
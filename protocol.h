@@ -0,0 +1,144 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "board.h"
+
+// Every message between a client and the server is a 4-byte frame:
+//   byte 0     bits 7..4 type, bits 1..0 ShotRes (result only)
+//   byte 1     cell y * 10 + x (shot, result), 1 if the receiver shoots first (start),
+//              1 if the sender won (over), part number (commit, reveal)
+//   bytes 2..3 little-endian match code (join, created), error code (error),
+//              16 bits of the commitment, of the layout or of the nonce
+//              (commit, reveal)
+//
+// A match on the wire, as each side's NetworkPlayer drives it:
+//   commit x8    before the first frame of the game, the commitment to the
+//                own layout with a nonce drawn for the game
+//   shot/result  one pair per shot, whoever has the turn sends the shot
+//   over, reveal x11  after game_over from both sides, the own layout in
+//                the clear (parts 0..6) and the nonce (parts 7..10),
+//                checked by the other side against the commitment and
+//                against every result it got; part 6 only has the bits of
+//                cells 96..99, a frame with more is invalid (so is such a
+//                board frame)
+// The server relays commit, shot, result, over and reveal between the two
+// players as they are. Several frames may come in one read or go out in
+// one write, a receiver must not assume anything about packet borders.
+//
+// A spectator sends watch with the match code and only receives from then on:
+//   board        16 bits of a plane of a field, byte 1 is
+//                (field * board_planes + plane) * reveal_parts + part;
+//                first the fields as they were before the oldest move the
+//                server still keeps, the ships plane only after the reveal
+//   move         a shot and its result, byte 0 the ShotRes, byte 1 the cell,
+//                value the player (0 the creator, 1 the joiner) who shot
+//   over         byte 1 the player who won, 2 if the match was abandoned
+// Field i is the field of player i, the one the other player shoots at.
+enum class FrameType : uint8_t {
+	create = 1, // client: host a new match
+	join,       // client: join the match with the code
+	created,    // server: the match is waiting for an opponent
+	start,      // server: both players are in
+	shot,       // both ways: a shot at the receiver's field
+	result,     // both ways: the result of the receiver's shot
+	left,       // server: the opponent has disconnected
+	error,      // server: the request failed
+	commit,     // both ways: a part of the hash of the sender's layout
+	over,       // both ways: the game has ended, as the sender saw it
+	reveal,     // both ways: a part of the sender's layout
+	watch,      // client: follow the match with the code as a spectator
+	move,       // server: a move of the watched match
+	board       // server: a part of the watched match's fields
+};
+
+const int commit_parts = 8;
+const int reveal_parts = 7;
+const int nonce_parts = 4;
+
+// the planes of a field in board frames
+enum class Plane : uint8_t {
+	misses,
+	hits,
+	sunk,
+	ships
+};
+
+const int board_planes = 4;
+
+enum class NetError : uint16_t {
+	no_such_match = 1,
+	lobby_full,
+	bad_frame
+};
+
+struct Frame {
+	FrameType type;
+	uint8_t cell = 0;
+	ShotRes res = ShotRes::hit;
+	uint16_t value = 0;
+};
+
+const size_t frame_size = 4;
+
+void encode(const Frame &frame, uint8_t* out);
+
+// false if the bytes are not a valid frame
+bool decode(const uint8_t* in, Frame &frame);
+
+inline Frame shot_frame(Coord shot) {
+	return Frame{FrameType::shot, uint8_t(shot.y * 10 + shot.x)};
+}
+
+inline Frame result_frame(Coord shot, ShotRes res) {
+	return Frame{FrameType::result, uint8_t(shot.y * 10 + shot.x), res};
+}
+
+inline Coord frame_coord(const Frame &frame) {
+	return Coord{frame.cell % 10, frame.cell / 10};
+}
+
+inline Frame move_frame(int player, int cell, ShotRes res) {
+	return Frame{FrameType::move, uint8_t(cell), res, uint16_t(player)};
+}
+
+inline Frame board_frame(int field, Plane plane, int part, uint16_t bits) {
+	return Frame{FrameType::board, uint8_t((field * board_planes + int(plane)) * reveal_parts + part),
+		ShotRes::hit, bits};
+}
+
+// true for the frames the server passes from one player to the other
+inline bool relayed(FrameType type) {
+	return type == FrameType::shot || type == FrameType::result || type == FrameType::commit
+		|| type == FrameType::over || type == FrameType::reveal;
+}
+
+// the first 128 bits of SHA-256 over the nonce and the layout, in 16-bit
+// parts; without the nonce they tell nothing about the layout, and no
+// other layout and nonce give the same parts
+struct Commitment {
+	uint16_t parts[commit_parts] = {};
+
+	friend bool operator==(const Commitment &a, const Commitment &b) {
+		for (int i = 0; i < commit_parts; i++) {
+			if (a.parts[i] != b.parts[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+Commitment layout_commitment(Bitboard ships, uint64_t nonce);
+
+// the 16-bit pieces of the layout and of the nonce
+uint16_t reveal_part(Bitboard ships, int part);
+
+void add_reveal_part(Bitboard &ships, int part, uint16_t bits);
+
+// what a spectator knows about a match, rebuilt from board and move frames
+struct MatchView {
+	Board fields[2];
+
+	// other frames are ignored
+	void apply(const Frame &frame);
+};
@@ -0,0 +1,149 @@
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "placement.h"
+#include "record.h"
+
+namespace {
+
+const char magic[8] = {'B', 'S', 'G', 'A', 'M', 'E', 'S', '1'};
+
+// the fleet of a field as bytes in fleet_lens order, false if it isn't a full fleet
+bool encode_fleet(const Board &field, uint8_t* out) {
+	if (field.ship_num != fleet_size) {
+		return false;
+	}
+
+	bool used[fleet_size] = {};
+	for (int i = 0; i < fleet_size; i++) {
+		int j = 0;
+		while (j < fleet_size && (used[j] || field.fleet[j].count() != fleet_lens[i])) {
+			j++;
+		}
+		if (j == fleet_size) {
+			return false;
+		}
+		used[j] = true;
+
+		Bitboard ship = field.fleet[j];
+		int cell = ship.lowest();
+		bool vertical = fleet_lens[i] > 1 && ship.test(cell + 10);
+		out[i] = uint8_t(cell | (vertical ? 0x80 : 0));
+	}
+	return true;
+}
+
+bool complete(const uint8_t* pos, const uint8_t* end) {
+	return pos < end && size_t(end - pos) >= record_header + pos[0];
+}
+
+}
+
+bool GameRecord::fleet(int player, Bitboard* ships) const {
+	const uint8_t* bytes = data + 1 + (player - 1) * fleet_size;
+	for (int i = 0; i < fleet_size; i++) {
+		int cell = bytes[i] & 0x7f;
+		int x = cell % 10;
+		int y = cell / 10;
+		int vertical = bytes[i] >> 7;
+		if (cell >= 100 || (vertical ? y : x) + fleet_lens[i] > 10) {
+			return false;
+		}
+		ships[i] = ship_mask(fleet_lens[i], x, y, vertical);
+	}
+	return true;
+}
+
+bool encode_record(const Board &field1, const Board &field2, const std::vector<Turn> &log,
+		std::vector<uint8_t> &out) {
+	uint8_t header[record_header];
+	if (log.size() > 255 || !encode_fleet(field1, header + 1) || !encode_fleet(field2, header + 1 + fleet_size)) {
+		return false;
+	}
+	header[0] = uint8_t(log.size());
+
+	out.insert(out.end(), header, header + record_header);
+	for (const Turn &turn : log) {
+		out.push_back(uint8_t(turn.shot.y * 10 + turn.shot.x) | (turn.res == ShotRes::miss ? 0x80 : 0));
+	}
+	return true;
+}
+
+RecordWriter::RecordWriter(const char* path) {
+	out = fopen(path, "ab");
+	if (out != nullptr && ftell(out) == 0 && fwrite(magic, sizeof(magic), 1, out) != 1) {
+		fclose(out);
+		out = nullptr;
+	}
+}
+
+RecordWriter::~RecordWriter() {
+	if (out != nullptr) {
+		fclose(out);
+	}
+}
+
+void RecordWriter::write(std::vector<uint8_t> &games) {
+	if (out != nullptr && !games.empty()) {
+		std::lock_guard<std::mutex> lock(mutex);
+		fwrite(games.data(), 1, games.size(), out);
+	}
+	games.clear();
+}
+
+RecordFile::~RecordFile() {
+	if (data != nullptr) {
+		munmap(const_cast<uint8_t*>(data), size);
+	}
+}
+
+bool RecordFile::open(const char* path) {
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(magic)) {
+		close(fd);
+		return false;
+	}
+
+	void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		return false;
+	}
+	if (memcmp(mapped, magic, sizeof(magic)) != 0) {
+		munmap(mapped, st.st_size);
+		return false;
+	}
+
+	// records are read front to back once
+	madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+	data = static_cast<const uint8_t*>(mapped);
+	size = st.st_size;
+	return true;
+}
+
+RecordFile::iterator& RecordFile::iterator::operator++() {
+	pos += record_header + pos[0];
+	if (!complete(pos, end)) {
+		pos = end;
+	}
+	return *this;
+}
+
+RecordFile::iterator RecordFile::begin() const {
+	if (data == nullptr) {
+		return iterator{nullptr, nullptr};
+	}
+	const uint8_t* first = data + sizeof(magic);
+	return iterator{complete(first, data + size) ? first : data + size, data + size};
+}
+
+RecordFile::iterator RecordFile::end() const {
+	return iterator{data + size, data + size};
+}
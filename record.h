@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+#include "board.h"
+#include "sim.h"
+
+// A record file is an 8-byte magic followed by games, one after another:
+//   byte 0         the number of shots n
+//   bytes 1..20    the fleets of player 1 and player 2, a byte per ship in
+//                  fleet_lens order: bits 6..0 the top left cell, bit 7 set
+//                  if the ship is vertical
+//   n bytes        the shots in order: bits 6..0 the cell, bit 7 set on a miss
+// The other results follow from the fleets. Player 1 shoots first and
+// a player keeps the turn until a miss, so who shot is known too.
+const size_t record_header = 21;
+
+// a game inside a record file, read in place
+struct GameRecord {
+	const uint8_t* data;
+
+	int shots() const {
+		return data[0];
+	}
+
+	size_t size() const {
+		return record_header + data[0];
+	}
+
+	// the fleet of player 1 or 2, ships in fleet_lens order; false if
+	// a ship doesn't lie on the field, as in a corrupt file
+	bool fleet(int player, Bitboard* ships) const;
+
+	// y is 10 or more for a cell off the field, Replay::load checks that
+	Coord shot(int i) const {
+		int cell = data[record_header + i] & 0x7f;
+		return Coord{cell % 10, cell / 10};
+	}
+
+	bool missed(int i) const {
+		return (data[record_header + i] & 0x80) != 0;
+	}
+};
+
+// appends the game to out; false if a field doesn't hold a full fleet
+bool encode_record(const Board &field1, const Board &field2, const std::vector<Turn> &log,
+		std::vector<uint8_t> &out);
+
+// appends games to a record file, from any number of threads; callers
+// encode into their own buffers and hand over whole batches
+struct RecordWriter {
+	explicit RecordWriter(const char* path);
+
+	~RecordWriter();
+
+	RecordWriter(const RecordWriter&) = delete;
+	RecordWriter& operator=(const RecordWriter&) = delete;
+
+	bool ok() const {
+		return out != nullptr;
+	}
+
+	// writes the encoded games and clears the buffer
+	void write(std::vector<uint8_t> &games);
+
+private:
+	std::mutex mutex;
+	FILE* out;
+};
+
+// a whole record file mapped into memory, iterated without copying; a game
+// cut short at the end of the file, as after a crash, is left out
+struct RecordFile {
+	RecordFile() = default;
+
+	~RecordFile();
+
+	RecordFile(const RecordFile&) = delete;
+	RecordFile& operator=(const RecordFile&) = delete;
+
+	// false if the file is missing or isn't a record file
+	bool open(const char* path);
+
+	struct iterator {
+		const uint8_t* pos;
+		const uint8_t* end;
+
+		GameRecord operator*() const {
+			return GameRecord{pos};
+		}
+
+		iterator& operator++();
+
+		bool operator!=(const iterator &other) const {
+			return pos != other.pos;
+		}
+	};
+
+	iterator begin() const;
+
+	iterator end() const;
+
+private:
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+};
@@ -0,0 +1,53 @@
+#include "metrics.h"
+#include "render.h"
+
+void board_colors(const Board &board, bool other, short* colors) {
+	for (int i = 0; i < 100; i++) {
+		switch (board.cell(i % 10, i / 10)) {
+			case Cell::ship:
+				colors[i] = 13;
+				break;
+			case Cell::halo:
+				colors[i] = other ? 5 : square;
+				break;
+			case Cell::miss:
+				colors[i] = 5;
+				break;
+			case Cell::hit:
+			case Cell::sunk:
+				colors[i] = 14;
+				break;
+			default:
+				colors[i] = square;
+				break;
+		}
+	}
+}
+
+void BoardView::invalidate() {
+	for (short &color : shown) {
+		color = -1;
+	}
+}
+
+void BoardView::draw(const short* colors) {
+	CallTimer timer(Call::draw, "screen");
+	for (int i = 0; i < 100; i++) {
+		int x = i % 10;
+		int y = i / 10;
+		short color = colors[i] != square ? colors[i] : (x + y) % 2 == 0 ? 7 : 10;
+		if (color == shown[i]) {
+			continue;
+		}
+		shown[i] = color;
+		wattron(win, COLOR_PAIR(color));
+		mvwprintw(win, y + 3, x * 2 + 4, "  ");
+		wattroff(win, COLOR_PAIR(color));
+	}
+	wnoutrefresh(win);
+}
+
+void update_screen() {
+	CallTimer timer(Call::update, "screen");
+	doupdate();
+}
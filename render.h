@@ -0,0 +1,33 @@
+#pragma once
+#include <ncurses.h>
+#include "board.h"
+
+// color pair of a board cell, square means the empty checkerboard square
+const short square = 0;
+
+// the color pairs of the cells of a board as the game shows them; on the
+// opponent's field (other) the halo around sunk ships is shown as misses
+void board_colors(const Board &board, bool other, short* colors);
+
+// the 10x10 cells of a field window, cell (x, y) at row y + 3, column 2x + 4;
+// remembers what every cell shows and redraws only the cells that changed
+struct BoardView {
+	explicit BoardView(WINDOW* win) : win(win) {
+		invalidate();
+	}
+
+	// the next draw repaints every cell, after the window was cleared
+	void invalidate();
+
+	// paints the cells whose color differs from the last frame and stages
+	// the window with wnoutrefresh, the caller ends the frame with doupdate
+	void draw(const short* colors);
+
+	WINDOW* win;
+
+private:
+	short shown[100];
+};
+
+// doupdate, timed when the metrics are on
+void update_screen();
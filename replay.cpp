@@ -0,0 +1,117 @@
+#include "placement.h"
+#include "replay.h"
+
+bool Replay::load(GameRecord rec) {
+	record = rec;
+	count = record.shots();
+	cur = 0;
+	if (count == 0) {
+		return false;
+	}
+
+	Bitboard ships[fleet_size];
+	for (int player = 1; player <= 2; player++) {
+		Board &field = fields[player - 1];
+		field.clear();
+		if (!record.fleet(player, ships)) {
+			return false;
+		}
+		for (const Bitboard &ship : ships) {
+			if (!field.can_place(ship)) {
+				return false;
+			}
+			field.place(ship);
+		}
+	}
+
+	int player = 1;
+	for (int i = 0; i < count; i++) {
+		if (i % snapshot_every == 0) {
+			Snapshot &s = snapshots[i / snapshot_every];
+			for (int f = 0; f < 2; f++) {
+				s.misses[f] = fields[f].misses;
+				s.hits[f] = fields[f].hits;
+				s.sunk[f] = fields[f].sunk;
+				s.alive[f] = fields[f].alive_ships_num;
+			}
+		}
+
+		if (record.shot(i).y >= 10) {
+			return false;
+		}
+		players[i] = player;
+		ShotRes res = apply(i);
+		results[i] = res;
+		if ((res == ShotRes::miss) != record.missed(i) || (res == ShotRes::game_over) != (i == count - 1)) {
+			return false;
+		}
+		if (res == ShotRes::miss) {
+			player = 3 - player;
+		}
+	}
+	cur = count;
+	return true;
+}
+
+ShotRes Replay::apply(int i) {
+	return fields[2 - players[i]].shoot(record.shot(i));
+}
+
+void Replay::restore(int snapshot) {
+	const Snapshot &s = snapshots[snapshot];
+	for (int f = 0; f < 2; f++) {
+		fields[f].misses = s.misses[f];
+		fields[f].hits = s.hits[f];
+		fields[f].sunk = s.sunk[f];
+		fields[f].alive_ships_num = s.alive[f];
+	}
+	cur = snapshot * snapshot_every;
+}
+
+void Replay::seek(int turn) {
+	if (turn < cur || turn - cur >= snapshot_every) {
+		// a game of k * snapshot_every shots has no snapshot at its very end
+		int snapshot = turn / snapshot_every;
+		restore(snapshot * snapshot_every < count ? snapshot : snapshot - 1);
+	}
+	while (cur < turn) {
+		step();
+	}
+}
+
+void Replay::step() {
+	apply(cur);
+	cur++;
+}
+
+Agreement compare(const Replay &replay, AbstractPlayer &bot, int player) {
+	Agreement agreement;
+
+	// the bot plays with the recorded fleet, its own field answers the
+	// other player's shots just like in the game
+	bot.arrange_ships();
+	bot.field_m.clear();
+	Bitboard ships[fleet_size];
+	replay.record.fleet(player, ships);
+	for (const Bitboard &ship : ships) {
+		bot.field_m.place(ship);
+	}
+
+	for (int i = 0; i < replay.shots(); i++) {
+		Turn turn = replay.shot(i);
+		if (turn.player != player) {
+			bot.get_shot(turn.shot);
+			continue;
+		}
+
+		Coord choice = bot.take_shot();
+		agreement.decisions++;
+		if (choice.x == turn.shot.x && choice.y == turn.shot.y) {
+			agreement.agreed++;
+		} else if (agreement.first_diff == -1) {
+			agreement.first_diff = i;
+		}
+		bot.get_res(turn.res, turn.shot);
+	}
+	return agreement;
+}
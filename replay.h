@@ -0,0 +1,76 @@
+#pragma once
+#include "player.h"
+#include "record.h"
+#include "sim.h"
+
+// both fields of a recorded game at any turn; loading replays the game
+// once and keeps the fields every snapshot_every shots, so a seek restores
+// the nearest snapshot and replays at most snapshot_every - 1 shots.
+// Holds no heap memory, one Replay can load any number of records
+struct Replay {
+	static const int snapshot_every = 16;
+
+	// false if the record isn't a legal game played to the end
+	bool load(GameRecord record);
+
+	int shots() const {
+		return count;
+	}
+
+	// the number of shots the fields show
+	int turn() const {
+		return cur;
+	}
+
+	void seek(int turn);
+
+	// the next shot, turn() < shots()
+	void step();
+
+	// shot i with the player who made it and its result
+	Turn shot(int i) const {
+		return Turn{players[i], record.shot(i), results[i]};
+	}
+
+	// the field of player 1 or 2, the one the other player shoots at
+	const Board& field(int player) const {
+		return fields[player - 1];
+	}
+
+	// the player who sank the last ship
+	int winner() const {
+		return players[count - 1];
+	}
+
+	GameRecord record;
+
+private:
+	struct Snapshot {
+		Bitboard misses[2];
+		Bitboard hits[2];
+		Bitboard sunk[2];
+		int alive[2];
+	};
+
+	void restore(int snapshot);
+
+	ShotRes apply(int i);
+
+	int count = 0;
+	int cur = 0;
+	Board fields[2];
+	ShotRes results[255];
+	int players[255];
+	Snapshot snapshots[255 / snapshot_every + 1];
+};
+
+struct Agreement {
+	int decisions = 0;
+	int agreed = 0;
+	int first_diff = -1; // the first shot the bot would have made differently
+};
+
+// walks the bot through the recorded game as the given player: on every
+// shot of that player the bot chooses its own shot, which is compared
+// with the recorded one, and then learns the recorded shot and result
+Agreement compare(const Replay &replay, AbstractPlayer &bot, int player);
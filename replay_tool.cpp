@@ -0,0 +1,191 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "bots.h"
+#include "pool.h"
+#include "record.h"
+#include "replay.h"
+#include "rng.h"
+
+namespace {
+
+void usage() {
+	fprintf(stderr,
+		"usage: battleship-replay [-t threads] [-s seed] FILE stats | show GAME [TURN] | compare BOT\n"
+		"stats    replays every game of the record file and seeks through each\n"
+		"show     prints both fields of the game (counted from 1) after TURN shots\n"
+		"compare  walks the bot through both sides of every game and counts how\n"
+		"         often it would have made the recorded shot\n");
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int stats(const std::vector<GameRecord> &games) {
+	auto start = std::chrono::steady_clock::now();
+	Replay replay;
+	uint64_t shots = 0;
+	uint64_t first_wins = 0;
+	uint64_t broken = 0;
+	for (const GameRecord &game : games) {
+		if (!replay.load(game)) {
+			broken++;
+			continue;
+		}
+		shots += replay.shots();
+		first_wins += replay.winner() == 1;
+	}
+	double load_time = seconds_since(start);
+
+	// every turn of every game in a scattered order
+	start = std::chrono::steady_clock::now();
+	uint64_t seeks = 0;
+	for (const GameRecord &game : games) {
+		if (!replay.load(game)) {
+			continue;
+		}
+		for (int i = 0; i <= replay.shots(); i++) {
+			replay.seek(i * 37 % (replay.shots() + 1));
+			seeks++;
+		}
+	}
+	double seek_time = seconds_since(start);
+
+	uint64_t played = games.size() - broken;
+	printf("%zu games, %llu broken, %.2f shots per game, the first shooter wins %.2f%%\n", games.size(),
+		(unsigned long long)broken, double(shots) / played, 100.0 * first_wins / played);
+	printf("replayed in %.2fs (%.0f games/s), %llu seeks in %.2fs (%.0f seeks/s)\n", load_time,
+		games.size() / load_time, (unsigned long long)seeks, seek_time, seeks / seek_time);
+	return broken == 0 ? 0 : 1;
+}
+
+void print_fields(const Replay &replay) {
+	// empty, ship, halo, miss, hit, sunk
+	static const char marks[] = ".#.oxX";
+	printf("player 1     player 2\n");
+	for (int y = 0; y < 10; y++) {
+		for (int player = 1; player <= 2; player++) {
+			printf(player == 1 ? "" : "   ");
+			for (int x = 0; x < 10; x++) {
+				putchar(marks[int(replay.field(player).cell(x, y))]);
+			}
+		}
+		putchar('\n');
+	}
+}
+
+int show(const std::vector<GameRecord> &games, int game, int turn) {
+	static const char* res_names[] = {"hit", "miss", "sank", "game over"};
+
+	Replay replay;
+	if (game < 1 || game > int(games.size()) || !replay.load(games[game - 1])) {
+		fprintf(stderr, "there is no game %d\n", game);
+		return 1;
+	}
+	if (turn < 0 || turn > replay.shots()) {
+		turn = replay.shots();
+	}
+	replay.seek(turn);
+
+	printf("game %d, %d of %d shots\n", game, turn, replay.shots());
+	if (turn > 0) {
+		Turn last = replay.shot(turn - 1);
+		printf("player %d: %c%d %s\n", last.player, 'A' + last.shot.x, last.shot.y + 1, res_names[int(last.res)]);
+	}
+	print_fields(replay);
+	return 0;
+}
+
+struct alignas(64) Tally {
+	uint64_t decisions = 0;
+	uint64_t agreed = 0;
+	uint64_t games_agreed = 0;
+	uint64_t games = 0;
+};
+
+int compare_all(const std::vector<GameRecord> &games, const std::string &bot_name, int threads,
+		uint64_t seed) {
+	std::vector<Tally> tallies(threads > 0 ? threads : 1);
+
+	auto start = std::chrono::steady_clock::now();
+	parallel_for(games.size(), threads, 64, [&](int worker, uint64_t begin, uint64_t end) {
+		Tally &tally = tallies[worker];
+		Replay replay;
+		for (uint64_t i = begin; i < end; i++) {
+			if (!replay.load(games[i])) {
+				continue;
+			}
+			for (int player = 1; player <= 2; player++) {
+				std::unique_ptr<AbstractPlayer> bot = make_bot(bot_name, stream_seed(seed, 2 * i + player - 1));
+				Agreement agreement = compare(replay, *bot, player);
+				tally.decisions += agreement.decisions;
+				tally.agreed += agreement.agreed;
+				tally.games_agreed += agreement.first_diff == -1;
+				tally.games++;
+			}
+		}
+	});
+	double elapsed = seconds_since(start);
+
+	Tally total;
+	for (const Tally &t : tallies) {
+		total.decisions += t.decisions;
+		total.agreed += t.agreed;
+		total.games_agreed += t.games_agreed;
+		total.games += t.games;
+	}
+	printf("%s: %llu sides of %zu games in %.2fs\n", bot_name.c_str(), (unsigned long long)total.games,
+		games.size(), elapsed);
+	printf("  the same shot %.2f%% of %llu times, all the same shots in %.2f%% of the sides\n",
+		100.0 * total.agreed / total.decisions, (unsigned long long)total.decisions,
+		100.0 * total.games_agreed / total.games);
+	return 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	int threads = default_threads();
+	uint64_t seed = 1;
+
+	int i = 1;
+	for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+		if (strcmp(argv[i], "-t") == 0) {
+			threads = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-s") == 0) {
+			seed = strtoull(argv[i + 1], nullptr, 10);
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (i + 1 >= argc) {
+		usage();
+		return 1;
+	}
+
+	RecordFile file;
+	if (!file.open(argv[i])) {
+		fprintf(stderr, "can't read the record file %s\n", argv[i]);
+		return 1;
+	}
+	std::vector<GameRecord> games;
+	for (GameRecord game : file) {
+		games.push_back(game);
+	}
+
+	std::string mode = argv[i + 1];
+	if (mode == "stats") {
+		return stats(games);
+	} else if (mode == "show" && i + 2 < argc) {
+		return show(games, atoi(argv[i + 2]), i + 3 < argc ? atoi(argv[i + 3]) : -1);
+	} else if (mode == "compare" && i + 2 < argc && make_bot(argv[i + 2], 0)) {
+		return compare_all(games, argv[i + 2], threads, seed);
+	}
+	usage();
+	return 1;
+}
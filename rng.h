@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+
+inline uint64_t splitmix64(uint64_t &state) {
+	uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+// independent seed for the stream-th generator derived from one master seed
+inline uint64_t stream_seed(uint64_t master, uint64_t stream) {
+	uint64_t state = master ^ splitmix64(stream);
+	return splitmix64(state);
+}
+
+// xoshiro256**, small enough to keep one per player
+struct Rng {
+	using result_type = uint64_t;
+
+	explicit Rng(uint64_t seed = 0) {
+		this->seed(seed);
+	}
+
+	void seed(uint64_t seed) {
+		for (uint64_t &w : s) {
+			w = splitmix64(seed);
+		}
+	}
+
+	static constexpr uint64_t min() {
+		return 0;
+	}
+
+	static constexpr uint64_t max() {
+		return ~uint64_t(0);
+	}
+
+	uint64_t operator()() {
+		uint64_t result = rotl(s[1] * 5, 7) * 9;
+		uint64_t t = s[1] << 17;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return result;
+	}
+
+	// uniform in [0, n)
+	uint32_t below(uint32_t n) {
+		return uint32_t(((*this)() >> 32) * n >> 32);
+	}
+
+	// the four words of the state, for code that steps many generators at once
+	const uint64_t* state() const {
+		return s;
+	}
+
+private:
+	static uint64_t rotl(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+
+	uint64_t s[4];
+};
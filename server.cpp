@@ -0,0 +1,676 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "pool.h"
+#include "protocol.h"
+#include "rng.h"
+
+// One reactor per thread, each with its own epoll set and its own
+// SO_REUSEPORT listening socket, so the kernel spreads the connections.
+// A match lives entirely in one reactor: when the joining player or a
+// spectator landed in another reactor, its socket is handed over to the
+// creator's one.
+//
+// Every move of a match goes into a ring of the last ring_moves moves;
+// the moves that fall out of it are applied to the fields kept next to it,
+// so a spectator joining late gets these fields and the ring. The frames
+// for the spectators produced by one read are encoded once into a shared
+// chunk, and each spectator only holds a reference to it until it's sent.
+
+namespace {
+
+struct Reactor;
+
+struct Match;
+
+// spectator frames, shared by all the spectators of a match
+using Chunk = std::shared_ptr<const std::vector<uint8_t>>;
+
+struct Conn {
+	int fd;
+	std::vector<uint8_t> in;
+	std::vector<uint8_t> out;
+	size_t out_pos = 0;
+	// sent after out, spectators only
+	std::deque<Chunk> shared;
+	size_t shared_pos = 0;
+	bool writing = false;
+	bool closed = false;
+	bool watching = false;
+	Conn* peer = nullptr;
+	Match* match = nullptr; // played, waited for or watched
+};
+
+const int ring_moves = 64;
+
+// a spectator that falls this many chunks behind is dropped
+const size_t max_backlog = 1024;
+
+// and so is a player with this many bytes of its opponent's frames unsent,
+// several times what a whole match sends
+const size_t max_relayed = max_backlog * frame_size;
+
+struct Match {
+	uint16_t code;
+	Conn* players[2] = {nullptr, nullptr};
+	int winner = 2;
+	// the fields before the oldest move in the ring
+	MatchView base;
+	Bitboard revealed[2];
+	uint8_t ring[ring_moves * frame_size];
+	int ring_begin = 0;
+	int ring_size = 0;
+	// spectator frames of the current read
+	std::vector<uint8_t> pending;
+	std::vector<Conn*> spectators;
+};
+
+// a client sends nothing between join or watch and the first frame from
+// the server, so the socket alone is enough
+struct Handoff {
+	int fd;
+	uint16_t code;
+	bool watch;
+};
+
+// codes of the hosted matches and the reactor holding each
+struct Lobby {
+	struct Entry {
+		Reactor* reactor;
+		bool started;
+	};
+
+	std::mutex mutex;
+	std::unordered_map<uint16_t, Entry> matches;
+	Rng rng{0x10bb7};
+
+	uint16_t add(Reactor* reactor) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (matches.size() >= 0xffff) {
+			return 0;
+		}
+		uint16_t code;
+		do {
+			code = uint16_t(rng.below(0xffff) + 1);
+		} while (matches.count(code) != 0);
+		matches[code] = Entry{reactor, false};
+		return code;
+	}
+
+	// the reactor of a match that still waits for an opponent
+	Reactor* take(uint16_t code) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = matches.find(code);
+		if (it == matches.end() || it->second.started) {
+			return nullptr;
+		}
+		it->second.started = true;
+		return it->second.reactor;
+	}
+
+	Reactor* find(uint16_t code) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = matches.find(code);
+		return it == matches.end() ? nullptr : it->second.reactor;
+	}
+
+	void remove(uint16_t code) {
+		std::lock_guard<std::mutex> lock(mutex);
+		matches.erase(code);
+	}
+};
+
+Lobby lobby;
+
+// tags of the non-connection descriptors in epoll_event.data.ptr
+char listen_tag;
+char wake_tag;
+
+struct Reactor {
+	explicit Reactor(int port);
+
+	void run();
+
+	// gives a joining player's socket to this reactor, from any thread
+	void post(Handoff handoff);
+
+private:
+	void accept_all();
+
+	Conn* add(int fd);
+
+	void on_readable(Conn* conn);
+
+	void on_frame(Conn* conn, const Frame &frame, const uint8_t* bytes);
+
+	void join(Conn* conn, uint16_t code);
+
+	void pair(Match* match, Conn* joiner);
+
+	void watch(Conn* conn, uint16_t code);
+
+	void subscribe(Match* match, Conn* conn);
+
+	// keeps the moves and the revealed layouts of a player's frame
+	void observe(Match* match, Conn* conn, const Frame &frame);
+
+	// sends the spectator frames of the current read to all spectators
+	void publish(Match* match);
+
+	void end_match(Match* match);
+
+	void queue(Conn* conn, const Frame &frame);
+
+	void flush(Conn* conn);
+
+	void drop(Conn* conn);
+
+	void take_handoffs();
+
+	int epfd;
+	int listen_fd;
+	int wake_fd;
+	std::mutex inbox_mutex;
+	std::vector<Handoff> inbox;
+	std::unordered_map<uint16_t, Match*> matches;
+	std::vector<Conn*> dead;
+};
+
+Reactor::Reactor(int port) {
+	epfd = epoll_create1(0);
+	wake_fd = eventfd(0, EFD_NONBLOCK);
+
+	listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	int one = 1;
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+			|| listen(listen_fd, SOMAXCONN) != 0) {
+		perror("can't listen");
+		exit(1);
+	}
+
+	epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.ptr = &listen_tag;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev);
+	ev.data.ptr = &wake_tag;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, wake_fd, &ev);
+}
+
+void Reactor::run() {
+	epoll_event events[256];
+	while (true) {
+		int n = epoll_wait(epfd, events, 256, -1);
+		for (int i = 0; i < n; i++) {
+			void* ptr = events[i].data.ptr;
+			if (ptr == &listen_tag) {
+				accept_all();
+			} else if (ptr == &wake_tag) {
+				take_handoffs();
+			} else {
+				Conn* conn = static_cast<Conn*>(ptr);
+				if (conn->closed) {
+					continue;
+				}
+				if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+					on_readable(conn);
+				}
+				if (!conn->closed && (events[i].events & EPOLLOUT)) {
+					flush(conn);
+				}
+			}
+		}
+
+		// connections closed in this round may still have had events in it
+		for (Conn* conn : dead) {
+			delete conn;
+		}
+		dead.clear();
+	}
+}
+
+void Reactor::post(Handoff handoff) {
+	{
+		std::lock_guard<std::mutex> lock(inbox_mutex);
+		inbox.push_back(handoff);
+	}
+	uint64_t one = 1;
+	ssize_t written = write(wake_fd, &one, sizeof(one));
+	(void)written;
+}
+
+void Reactor::accept_all() {
+	while (true) {
+		int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+		if (fd < 0) {
+			return;
+		}
+		add(fd);
+	}
+}
+
+Conn* Reactor::add(int fd) {
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	Conn* conn = new Conn();
+	conn->fd = fd;
+
+	epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.ptr = conn;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+	return conn;
+}
+
+void Reactor::on_readable(Conn* conn) {
+	uint8_t buf[4096];
+	ssize_t n = recv(conn->fd, buf, sizeof(buf), 0);
+	if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+		drop(conn);
+		return;
+	} else if (n < 0) {
+		return;
+	}
+
+	conn->in.insert(conn->in.end(), buf, buf + n);
+
+	size_t pos = 0;
+	Conn* peer = conn->peer;
+	while (conn->in.size() - pos >= frame_size && !conn->closed && conn->fd >= 0) {
+		Frame frame;
+		if (!decode(conn->in.data() + pos, frame)) {
+			queue(conn, Frame{FrameType::error, 0, ShotRes::hit, uint16_t(NetError::bad_frame)});
+			flush(conn);
+			drop(conn);
+			return;
+		}
+		on_frame(conn, frame, conn->in.data() + pos);
+		pos += frame_size;
+	}
+
+	// the connection was handed over to another reactor
+	if (conn->fd < 0 || conn->closed) {
+		return;
+	}
+	conn->in.erase(conn->in.begin(), conn->in.begin() + pos);
+
+	// everything relayed from this read goes out in one send
+	if (peer != nullptr && !peer->closed) {
+		flush(peer);
+	}
+	if (conn->match != nullptr) {
+		publish(conn->match);
+	}
+}
+
+void Reactor::on_frame(Conn* conn, const Frame &frame, const uint8_t* bytes) {
+	if (conn->watching) {
+		return;
+	}
+	if (conn->peer != nullptr) {
+		if (relayed(frame.type)) {
+			Conn* peer = conn->peer;
+			if (peer->out.size() >= max_relayed) {
+				// ends the match too
+				drop(peer);
+				return;
+			}
+			peer->out.insert(peer->out.end(), bytes, bytes + frame_size);
+		}
+		observe(conn->match, conn, frame);
+		return;
+	}
+	if (conn->match != nullptr) {
+		return;
+	}
+
+	if (frame.type == FrameType::create) {
+		uint16_t code = lobby.add(this);
+		if (code == 0) {
+			queue(conn, Frame{FrameType::error, 0, ShotRes::hit, uint16_t(NetError::lobby_full)});
+		} else {
+			Match* match = new Match();
+			match->code = code;
+			match->players[0] = conn;
+			conn->match = match;
+			matches[code] = match;
+			queue(conn, Frame{FrameType::created, 0, ShotRes::hit, code});
+		}
+		flush(conn);
+	} else if (frame.type == FrameType::join) {
+		join(conn, frame.value);
+	} else if (frame.type == FrameType::watch) {
+		watch(conn, frame.value);
+	}
+}
+
+void Reactor::join(Conn* conn, uint16_t code) {
+	Reactor* owner = lobby.take(code);
+	if (owner == nullptr) {
+		queue(conn, Frame{FrameType::error, 0, ShotRes::hit, uint16_t(NetError::no_such_match)});
+		flush(conn);
+		return;
+	}
+
+	if (owner == this) {
+		auto it = matches.find(code);
+		if (it != matches.end()) {
+			pair(it->second, conn);
+		}
+		return;
+	}
+
+	epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, nullptr);
+	Handoff handoff{conn->fd, code, false};
+	conn->fd = -1;
+	conn->closed = true;
+	dead.push_back(conn);
+	owner->post(handoff);
+}
+
+void Reactor::pair(Match* match, Conn* joiner) {
+	Conn* creator = match->players[0];
+	match->players[1] = joiner;
+	joiner->match = match;
+	creator->peer = joiner;
+	joiner->peer = creator;
+
+	queue(creator, Frame{FrameType::start, 1});
+	queue(joiner, Frame{FrameType::start, 0});
+	flush(creator);
+	flush(joiner);
+}
+
+void Reactor::watch(Conn* conn, uint16_t code) {
+	Reactor* owner = lobby.find(code);
+	auto it = matches.find(code);
+	if (owner == this && it != matches.end()) {
+		subscribe(it->second, conn);
+		return;
+	} else if (owner == nullptr || owner == this) {
+		queue(conn, Frame{FrameType::error, 0, ShotRes::hit, uint16_t(NetError::no_such_match)});
+		flush(conn);
+		return;
+	}
+
+	epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, nullptr);
+	Handoff handoff{conn->fd, code, true};
+	conn->fd = -1;
+	conn->closed = true;
+	dead.push_back(conn);
+	owner->post(handoff);
+}
+
+void Reactor::subscribe(Match* match, Conn* conn) {
+	conn->watching = true;
+	conn->match = match;
+	match->spectators.push_back(conn);
+
+	// the spectator frames of a read are published at its end, so the ring
+	// holds every move sent so far and nothing is sent twice
+	for (int field = 0; field < 2; field++) {
+		const Board &board = match->base.fields[field];
+		Bitboard planes[board_planes] = {board.misses, board.hits, board.sunk, match->revealed[field]};
+		for (int plane = 0; plane < board_planes; plane++) {
+			for (int part = 0; part < reveal_parts; part++) {
+				uint16_t bits = reveal_part(planes[plane], part);
+				if (bits != 0) {
+					queue(conn, board_frame(field, Plane(plane), part, bits));
+				}
+			}
+		}
+	}
+	for (int i = 0; i < match->ring_size; i++) {
+		const uint8_t* move = match->ring + (match->ring_begin + i) % ring_moves * frame_size;
+		conn->out.insert(conn->out.end(), move, move + frame_size);
+	}
+	flush(conn);
+}
+
+void Reactor::observe(Match* match, Conn* conn, const Frame &frame) {
+	int player = conn == match->players[0] ? 0 : 1;
+	uint8_t bytes[frame_size];
+
+	if (frame.type == FrameType::result) {
+		// the result comes from the player that was shot at
+		int shooter = 1 - player;
+		encode(move_frame(shooter, frame.cell, frame.res), bytes);
+		if (frame.res == ShotRes::game_over) {
+			match->winner = shooter;
+		}
+
+		if (match->ring_size == ring_moves) {
+			Frame oldest;
+			decode(match->ring + match->ring_begin * frame_size, oldest);
+			match->base.apply(oldest);
+			match->ring_begin = (match->ring_begin + 1) % ring_moves;
+			match->ring_size--;
+		}
+		int slot = (match->ring_begin + match->ring_size) % ring_moves;
+		memcpy(match->ring + slot * frame_size, bytes, frame_size);
+		match->ring_size++;
+	} else if (frame.type == FrameType::reveal && frame.cell < reveal_parts) {
+		add_reveal_part(match->revealed[player], frame.cell, frame.value);
+		encode(board_frame(player, Plane::ships, frame.cell, frame.value), bytes);
+	} else {
+		return;
+	}
+
+	if (!match->spectators.empty()) {
+		match->pending.insert(match->pending.end(), bytes, bytes + frame_size);
+	}
+}
+
+void Reactor::publish(Match* match) {
+	if (match->pending.empty()) {
+		return;
+	}
+	Chunk chunk = std::make_shared<const std::vector<uint8_t>>(std::move(match->pending));
+	match->pending.clear();
+
+	// a spectator dropped on the way leaves the list
+	std::vector<Conn*> spectators = match->spectators;
+	for (Conn* spectator : spectators) {
+		if (spectator->shared.size() >= max_backlog) {
+			drop(spectator);
+			continue;
+		}
+		spectator->shared.push_back(chunk);
+		flush(spectator);
+	}
+}
+
+void Reactor::end_match(Match* match) {
+	if (!match->spectators.empty()) {
+		uint8_t bytes[frame_size];
+		encode(Frame{FrameType::over, uint8_t(match->winner)}, bytes);
+		match->pending.insert(match->pending.end(), bytes, bytes + frame_size);
+		publish(match);
+	}
+
+	for (Conn* spectator : match->spectators) {
+		spectator->match = nullptr;
+	}
+	for (Conn* player : match->players) {
+		if (player != nullptr) {
+			player->match = nullptr;
+		}
+	}
+	lobby.remove(match->code);
+	matches.erase(match->code);
+	delete match;
+}
+
+void Reactor::take_handoffs() {
+	uint64_t count;
+	ssize_t got = read(wake_fd, &count, sizeof(count));
+	(void)got;
+
+	std::vector<Handoff> handoffs;
+	{
+		std::lock_guard<std::mutex> lock(inbox_mutex);
+		handoffs.swap(inbox);
+	}
+
+	for (Handoff &handoff : handoffs) {
+		Conn* conn = add(handoff.fd);
+		auto it = matches.find(handoff.code);
+		if (it == matches.end()) {
+			// the match ended while the socket was on its way
+			queue(conn, Frame{FrameType::error, 0, ShotRes::hit, uint16_t(NetError::no_such_match)});
+			flush(conn);
+		} else if (handoff.watch) {
+			subscribe(it->second, conn);
+		} else {
+			pair(it->second, conn);
+		}
+	}
+}
+
+void Reactor::queue(Conn* conn, const Frame &frame) {
+	uint8_t bytes[frame_size];
+	encode(frame, bytes);
+	conn->out.insert(conn->out.end(), bytes, bytes + frame_size);
+}
+
+void Reactor::flush(Conn* conn) {
+	while (conn->out_pos < conn->out.size() || !conn->shared.empty()) {
+		iovec iov[16];
+		int count = 0;
+		if (conn->out_pos < conn->out.size()) {
+			iov[count++] = iovec{conn->out.data() + conn->out_pos, conn->out.size() - conn->out_pos};
+		}
+		size_t pos = conn->shared_pos;
+		for (size_t i = 0; i < conn->shared.size() && count < 16; i++) {
+			const std::vector<uint8_t> &chunk = *conn->shared[i];
+			iov[count++] = iovec{const_cast<uint8_t*>(chunk.data()) + pos, chunk.size() - pos};
+			pos = 0;
+		}
+
+		msghdr msg = {};
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+		ssize_t n = sendmsg(conn->fd, &msg, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EAGAIN) {
+				break;
+			}
+			drop(conn);
+			return;
+		}
+
+		size_t sent = n;
+		size_t own = std::min(sent, conn->out.size() - conn->out_pos);
+		conn->out_pos += own;
+		sent -= own;
+		if (conn->out_pos == conn->out.size()) {
+			conn->out.clear();
+			conn->out_pos = 0;
+		}
+		while (sent > 0) {
+			size_t left = conn->shared.front()->size() - conn->shared_pos;
+			if (sent < left) {
+				conn->shared_pos += sent;
+				break;
+			}
+			sent -= left;
+			conn->shared.pop_front();
+			conn->shared_pos = 0;
+		}
+	}
+
+	bool pending = conn->out_pos < conn->out.size() || !conn->shared.empty();
+	if (pending != conn->writing) {
+		conn->writing = pending;
+		epoll_event ev = {};
+		ev.events = EPOLLIN | (pending ? uint32_t(EPOLLOUT) : 0);
+		ev.data.ptr = conn;
+		epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+	}
+}
+
+void Reactor::drop(Conn* conn) {
+	if (conn->closed) {
+		return;
+	}
+	conn->closed = true;
+
+	epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, nullptr);
+	close(conn->fd);
+
+	if (conn->match != nullptr && conn->watching) {
+		std::vector<Conn*> &spectators = conn->match->spectators;
+		spectators.erase(std::find(spectators.begin(), spectators.end(), conn));
+	} else if (conn->match != nullptr) {
+		end_match(conn->match);
+	}
+	if (conn->peer != nullptr) {
+		Conn* peer = conn->peer;
+		peer->peer = nullptr;
+		queue(peer, Frame{FrameType::left});
+		flush(peer);
+	}
+	dead.push_back(conn);
+}
+
+void usage() {
+	fprintf(stderr, "usage: battleship-server [-p port] [-t threads]\n");
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	int port = 7777;
+	int threads = default_threads();
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+			port = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else {
+			usage();
+			return 1;
+		}
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	std::vector<std::unique_ptr<Reactor>> reactors;
+	for (int i = 0; i < threads || i == 0; i++) {
+		reactors.push_back(std::make_unique<Reactor>(port));
+	}
+	printf("battleship-server listening on port %d, %zu threads\n", port, reactors.size());
+	fflush(stdout);
+
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < reactors.size(); i++) {
+		workers.emplace_back(&Reactor::run, reactors[i].get());
+	}
+	reactors[0]->run();
+	return 0;
+}
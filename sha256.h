@@ -0,0 +1,9 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+const size_t sha256_size = 32;
+
+// SHA-256 (FIPS 180-4) of the bytes, for commitments that the other side
+// of a network match must not be able to open before the reveal
+void sha256(const uint8_t* data, size_t size, uint8_t* digest);
@@ -0,0 +1,5 @@
+#include "sim.h"
+
+MatchResult run_match(AbstractPlayer &player1, AbstractPlayer &player2, bool keep_log) {
+	return play_match(player1, player2, keep_log);
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <cassert>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+#include "metrics.h"
+#include "player.h"
+
+struct Turn {
+	int player; // 1 or 2
+	Coord shot;
+	ShotRes res;
+};
+
+struct MatchResult {
+	int winner = 0; // 1 or 2
+	int shots = 0;
+	int player_shots[2] = {0, 0};
+	std::vector<Turn> log;
+};
+
+namespace sim_detail {
+
+// P's own members, called without the vtable unless P is abstract; the
+// calls of a game are timed here when the metrics are on
+template <typename P>
+struct Calls {
+	static constexpr bool direct = !std::is_abstract<P>::value;
+
+	static const char* name(P &p) {
+		if constexpr (direct) {
+			return p.P::name();
+		} else {
+			return p.name();
+		}
+	}
+
+	template <typename F>
+	static auto timed(Call call, P &p, F &&f) {
+		if (!metrics_enabled()) {
+			return f();
+		}
+		CallTimer timer(call, name(p));
+		return f();
+	}
+
+	static void arrange_ships(P &p) {
+		timed(Call::arrange_ships, p, [&] {
+			if constexpr (direct) {
+				p.P::arrange_ships();
+			} else {
+				p.arrange_ships();
+			}
+		});
+	}
+
+	static Coord take_shot(P &p) {
+		return timed(Call::take_shot, p, [&] {
+			if constexpr (direct) {
+				return p.P::take_shot();
+			} else {
+				return p.take_shot();
+			}
+		});
+	}
+
+	static ShotRes get_shot(P &p, Coord xy) {
+		return timed(Call::get_shot, p, [&] {
+			if constexpr (direct) {
+				return p.P::get_shot(xy);
+			} else {
+				return p.get_shot(xy);
+			}
+		});
+	}
+
+	static void get_res(P &p, ShotRes res, Coord shot) {
+		timed(Call::get_res, p, [&] {
+			if constexpr (direct) {
+				p.P::get_res(res, shot);
+			} else {
+				p.get_res(res, shot);
+			}
+		});
+	}
+
+	static void game_res(P &p, GameRes res) {
+		if constexpr (direct) {
+			p.P::game_res(res);
+		} else {
+			p.game_res(res);
+		}
+	}
+};
+
+template <typename Shooter, typename Target>
+bool play_turn(Shooter &shooter, Target &target, int cur_player, MatchResult &result, bool keep_log,
+		ShotRes &res) {
+	Coord shot = Calls<Shooter>::take_shot(shooter);
+	res = Calls<Target>::get_shot(target, shot);
+	Calls<Shooter>::get_res(shooter, res, shot);
+
+	result.shots++;
+	result.player_shots[cur_player - 1]++;
+	if (keep_log) {
+		result.log.push_back(Turn{cur_player, shot, res});
+	}
+
+	if (res == ShotRes::game_over) {
+		result.winner = cur_player;
+		Calls<Shooter>::game_res(shooter, GameRes::win);
+		Calls<Target>::game_res(target, GameRes::loss);
+		return true;
+	}
+	return false;
+}
+
+}
+
+// plays a whole game: both players arrange their ships, then shoot in
+// turns, a player keeps the turn until a miss; player1 shoots first.
+// With concrete player types every call is direct and can be inlined, the
+// players then have to be exactly of these types, not of derived ones
+template <typename P1, typename P2>
+MatchResult play_match(P1 &player1, P2 &player2, bool keep_log = true) {
+	assert(std::is_abstract<P1>::value || typeid(player1) == typeid(P1));
+	assert(std::is_abstract<P2>::value || typeid(player2) == typeid(P2));
+
+	MatchResult result;
+	sim_detail::Calls<P1>::arrange_ships(player1);
+	sim_detail::Calls<P2>::arrange_ships(player2);
+
+	ShotRes res;
+	while (true) {
+		do {
+			if (sim_detail::play_turn(player1, player2, 1, result, keep_log, res)) {
+				return result;
+			}
+		} while (res != ShotRes::miss);
+		do {
+			if (sim_detail::play_turn(player2, player1, 2, result, keep_log, res)) {
+				return result;
+			}
+		} while (res != ShotRes::miss);
+	}
+}
+
+// the same through the virtual interface, for the interface and network players
+MatchResult run_match(AbstractPlayer &player1, AbstractPlayer &player2, bool keep_log = true);
@@ -0,0 +1,1097 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+#include "accumulate.h"
+#include "arrange.h"
+#include "batch.h"
+#include "bots.h"
+#include "cache.h"
+#include "endgame.h"
+#include "net.h"
+#include "metrics.h"
+#include "placement.h"
+#include "pool.h"
+#include "protocol.h"
+#include "record.h"
+#include "replay.h"
+#include "rng.h"
+#include "sha256.h"
+#include "sim.h"
+#include "tune.h"
+#include "variant.h"
+
+// Checks of the game core, one test per argument; without arguments all of
+// them run. CMake registers every test with ctest by its name.
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond) check(cond, #cond, __FILE__, __LINE__)
+
+void check(bool ok, const char* what, const char* file, int line) {
+	if (!ok) {
+		fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+		failures++;
+	}
+}
+
+void protocol_round_trip() {
+	// every frame the encoder can produce decodes to itself
+	for (int type = int(FrameType::create); type <= int(FrameType::board); type++) {
+		for (int cell = 0; cell < 256; cell++) {
+			for (int res = 0; res < 4; res++) {
+				Frame frame{FrameType(type), uint8_t(cell), ShotRes(res), uint16_t(cell * 257 + res)};
+				uint8_t bytes[frame_size];
+				encode(frame, bytes);
+				Frame back;
+				if (decode(bytes, back)) {
+					CHECK(back.type == frame.type && back.cell == frame.cell && back.res == frame.res
+						&& back.value == frame.value);
+				}
+			}
+		}
+	}
+
+	// and the frames the players send are valid
+	Frame frames[] = {
+		shot_frame(Coord{9, 9}),
+		result_frame(Coord{3, 7}, ShotRes::game_over),
+		move_frame(1, 42, ShotRes::sank),
+		board_frame(1, Plane::ships, reveal_parts - 1, 0xe),
+		Frame{FrameType::join, 0, ShotRes::hit, 0xffff},
+	};
+	for (const Frame &frame : frames) {
+		uint8_t bytes[frame_size];
+		encode(frame, bytes);
+		Frame back;
+		CHECK(decode(bytes, back));
+		CHECK(back.type == frame.type && back.cell == frame.cell && back.value == frame.value);
+	}
+
+	Frame bad;
+	uint8_t unknown[frame_size] = {0xf0, 0, 0, 0};
+	CHECK(!decode(unknown, bad));
+	uint8_t off_field[frame_size] = {uint8_t(int(FrameType::shot) << 4), 100, 0, 0};
+	CHECK(!decode(off_field, bad));
+	// cells 100 and up in the last part of a layout
+	uint8_t past_end[frame_size] = {uint8_t(int(FrameType::reveal) << 4), reveal_parts - 1, 0x20, 0};
+	CHECK(!decode(past_end, bad));
+	encode(board_frame(0, Plane::hits, reveal_parts - 1, 0x10), past_end);
+	CHECK(!decode(past_end, bad));
+
+	Rng rng(1);
+	for (int i = 0; i < 1000; i++) {
+		Bitboard ships = Bitboard{rng(), rng() & Bitboard::hi_mask};
+		Bitboard back;
+		for (int part = 0; part < reveal_parts; part++) {
+			add_reveal_part(back, part, reveal_part(ships, part));
+		}
+		CHECK(back == ships);
+	}
+}
+
+std::string hex(const uint8_t* bytes, size_t size) {
+	std::string text;
+	for (size_t i = 0; i < size; i++) {
+		char digits[3];
+		snprintf(digits, sizeof(digits), "%02x", bytes[i]);
+		text += digits;
+	}
+	return text;
+}
+
+std::string sha256_hex(const std::string &message) {
+	uint8_t digest[sha256_size];
+	sha256(reinterpret_cast<const uint8_t*>(message.data()), message.size(), digest);
+	return hex(digest, sha256_size);
+}
+
+void placement_table_layout() {
+	int count[5] = {};
+	for (int ship_len = 1; ship_len < 5; ship_len++) {
+		for (const Placement &p : placements(ship_len)) {
+			CHECK(p.ship.count() == ship_len);
+			CHECK(p.halo == halo(p.ship));
+			count[ship_len]++;
+		}
+	}
+	CHECK(count[1] == 100 && count[2] == 180 && count[3] == 160 && count[4] == 140);
+
+	// every position sits where placement_index says, and only there
+	bool seen[580] = {};
+	for (int ship_len = 1; ship_len < 5; ship_len++) {
+		for (int cell = 0; cell < 100; cell++) {
+			for (int orientation = 0; orientation < (ship_len == 1 ? 1 : 2); orientation++) {
+				int x = cell % 10;
+				int y = cell / 10;
+				if ((orientation == 0 ? x : y) + ship_len > 10) {
+					continue;
+				}
+				int index = placement_index(ship_len, cell, orientation);
+				CHECK(index >= placement_offset[ship_len] && index < placement_offset[ship_len + 1]);
+				CHECK(!seen[index]);
+				seen[index] = true;
+				CHECK(placement_table.p[index].ship == ship_mask(ship_len, x, y, orientation));
+			}
+		}
+	}
+	CHECK(std::count(seen, seen + 580, true) == 580);
+}
+
+// on a 4x3 corner, a 2 cell ship and a single cell one; each ship is
+// uniform among the positions the earlier one leaves, as the header says
+void sample_ships_chi_square() {
+	Bitboard corner;
+	for (int y = 0; y < 3; y++) {
+		for (int x = 0; x < 4; x++) {
+			corner |= Bitboard::cell(x, y);
+		}
+	}
+	Bitboard taken = ~corner;
+	const int lens[2] = {2, 1};
+
+	// the probability of every pair of positions, and of a dead end
+	std::map<std::pair<int, int>, double> expected;
+	double dead_end = 0;
+	std::vector<int> firsts;
+	for (int i = placement_offset[2]; i < placement_offset[3]; i++) {
+		if ((placement_table.p[i].ship & taken).empty()) {
+			firsts.push_back(i);
+		}
+	}
+	for (int first : firsts) {
+		Bitboard left = taken | placement_table.p[first].ship | placement_table.p[first].halo;
+		std::vector<int> seconds;
+		for (int i = placement_offset[1]; i < placement_offset[2]; i++) {
+			if ((placement_table.p[i].ship & left).empty()) {
+				seconds.push_back(i);
+			}
+		}
+		if (seconds.empty()) {
+			dead_end += 1.0 / firsts.size();
+		}
+		for (int second : seconds) {
+			expected[{first, second}] = 1.0 / firsts.size() / seconds.size();
+		}
+	}
+	CHECK(firsts.size() == 17 && expected.size() == 74);
+
+	Rng rng(12);
+	int draws = 100000;
+	std::map<std::pair<int, int>, int> observed;
+	int dead_ends = 0;
+	Bitboard ships[2];
+	for (int d = 0; d < draws; d++) {
+		if (!sample_ships(rng, taken, lens, 2, ships)) {
+			dead_ends++;
+			continue;
+		}
+		std::pair<int, int> key{-1, -1};
+		for (int i = 0; i < 580; i++) {
+			if (placement_table.p[i].ship == ships[0] && i >= placement_offset[2] && i < placement_offset[3]) {
+				key.first = i;
+			} else if (placement_table.p[i].ship == ships[1] && i < placement_offset[2]) {
+				key.second = i;
+			}
+		}
+		CHECK(expected.count(key) == 1);
+		observed[key]++;
+	}
+
+	double chi = 0;
+	for (const auto &e : expected) {
+		double want = e.second * draws;
+		chi += (observed[e.first] - want) * (observed[e.first] - want) / want;
+	}
+	if (dead_end > 0) {
+		chi += (dead_ends - dead_end * draws) * (dead_ends - dead_end * draws) / (dead_end * draws);
+	} else {
+		CHECK(dead_ends == 0);
+	}
+	// far above the 99.9th percentile for this many degrees of freedom
+	int freedom = int(expected.size()) - (dead_end > 0 ? 0 : 1);
+	CHECK(chi < freedom + 6 * std::sqrt(2.0 * freedom));
+}
+
+void commitment() {
+	// the FIPS 180-4 examples and a message that needs a second padding block
+	CHECK(sha256_hex("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	CHECK(sha256_hex("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	CHECK(sha256_hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")
+		== "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+	CHECK(sha256_hex(std::string(1000, 'a'))
+		== "41edece42d63e8d9bf515a9ba6932e1c20cbc9f5a5d134645adb5db1b9737ea3");
+
+	Rng rng(2);
+	Bitboard ships[fleet_size];
+	random_fleet(rng, ships);
+	Bitboard layout;
+	for (const Bitboard &ship : ships) {
+		layout |= ship;
+	}
+	Commitment c = layout_commitment(layout, 12345);
+	CHECK(c == layout_commitment(layout, 12345));
+	CHECK(!(c == layout_commitment(layout, 12346)));
+	Bitboard other = layout;
+	other.lo ^= 1;
+	CHECK(!(c == layout_commitment(other, 12345)));
+}
+
+// a listening socket on a free local port
+int listen_local(int &port) {
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t len = sizeof(addr);
+	if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 1) != 0
+			|| getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+		return -1;
+	}
+	port = ntohs(addr.sin_port);
+	return fd;
+}
+
+void link_framing() {
+	int port;
+	int server = listen_local(port);
+	CHECK(server >= 0);
+	if (server < 0) {
+		return;
+	}
+	Link link("127.0.0.1", port);
+	int peer = accept(server, nullptr, nullptr);
+	CHECK(peer >= 0);
+
+	// frames sent by the link go out in one batch on flush
+	std::vector<Frame> sent;
+	for (int i = 0; i < 50; i++) {
+		sent.push_back(i % 2 == 0 ? shot_frame(Coord{i % 10, i / 10}) : result_frame(Coord{i % 10, 9}, ShotRes(i % 4)));
+	}
+	for (const Frame &frame : sent) {
+		link.send(frame);
+	}
+	link.flush();
+	std::vector<uint8_t> got(sent.size() * frame_size);
+	size_t have = 0;
+	while (have < got.size()) {
+		ssize_t n = recv(peer, got.data() + have, got.size() - have, 0);
+		CHECK(n > 0);
+		if (n <= 0) {
+			break;
+		}
+		have += n;
+	}
+	for (size_t i = 0; i < sent.size(); i++) {
+		Frame frame;
+		CHECK(decode(got.data() + i * frame_size, frame));
+		CHECK(frame.type == sent[i].type && frame.cell == sent[i].cell && frame.res == sent[i].res);
+	}
+
+	// frames cut at any byte and glued together come out whole
+	std::vector<uint8_t> stream;
+	std::vector<Frame> frames;
+	for (int i = 0; i < 300; i++) {
+		Frame frame{FrameType::commit, uint8_t(i % commit_parts), ShotRes::hit, uint16_t(i * 7919)};
+		frames.push_back(frame);
+		stream.resize(stream.size() + frame_size);
+		encode(frame, stream.data() + stream.size() - frame_size);
+	}
+	Rng rng(3);
+	for (size_t pos = 0; pos < stream.size(); ) {
+		size_t n = 1 + rng.below(11);
+		n = n < stream.size() - pos ? n : stream.size() - pos;
+		CHECK(send(peer, stream.data() + pos, n, 0) == ssize_t(n));
+		pos += n;
+	}
+	for (const Frame &sent_frame : frames) {
+		Frame frame = link.recv();
+		CHECK(frame.type == sent_frame.type && frame.cell == sent_frame.cell && frame.value == sent_frame.value);
+	}
+
+	close(peer);
+	close(server);
+}
+
+// the peer commits to the layout, ends the game and reveals it; whether
+// the player on this side takes it as the peer's fleet
+bool revealed_verified(Bitboard layout) {
+	int port;
+	int server = listen_local(port);
+	if (server < 0) {
+		return false;
+	}
+	Link link("127.0.0.1", port);
+	int peer = accept(server, nullptr, nullptr);
+
+	EasyPlayer local(1);
+	local.arrange_ships();
+	NetworkPlayer opponent(link, local);
+
+	uint64_t nonce = 77;
+	Commitment c = layout_commitment(layout, nonce);
+	std::vector<Frame> frames;
+	for (int part = 0; part < commit_parts; part++) {
+		frames.push_back(Frame{FrameType::commit, uint8_t(part), ShotRes::hit, c.parts[part]});
+	}
+	frames.push_back(Frame{FrameType::over, 1, ShotRes::hit, 0});
+	for (int part = 0; part < reveal_parts; part++) {
+		frames.push_back(Frame{FrameType::reveal, uint8_t(part), ShotRes::hit, reveal_part(layout, part)});
+	}
+	for (int part = 0; part < nonce_parts; part++) {
+		frames.push_back(Frame{FrameType::reveal, uint8_t(reveal_parts + part), ShotRes::hit,
+			uint16_t(nonce >> (16 * part))});
+	}
+	std::vector<uint8_t> bytes(frames.size() * frame_size);
+	for (size_t i = 0; i < frames.size(); i++) {
+		encode(frames[i], bytes.data() + i * frame_size);
+	}
+	CHECK(send(peer, bytes.data(), bytes.size(), 0) == ssize_t(bytes.size()));
+
+	try {
+		opponent.game_res(GameRes::win);
+	} catch (const NetworkError&) {
+	}
+	close(peer);
+	close(server);
+	return opponent.opponent_verified();
+}
+
+void repeated_shot() {
+	int port;
+	int server = listen_local(port);
+	CHECK(server >= 0);
+	if (server < 0) {
+		return;
+	}
+	Link link("127.0.0.1", port);
+	int peer = accept(server, nullptr, nullptr);
+
+	EasyPlayer local(1);
+	local.arrange_ships();
+	NetworkPlayer opponent(link, local);
+
+	// the peer commits, then shoots at a cell and at the same cell again
+	uint8_t bytes[(commit_parts + 2) * frame_size];
+	for (int part = 0; part < commit_parts; part++) {
+		encode(Frame{FrameType::commit, uint8_t(part), ShotRes::hit, 0}, bytes + part * frame_size);
+	}
+	int cell = local.field_m.ships.lowest();
+	Coord ship_cell{cell % 10, cell / 10};
+	encode(shot_frame(ship_cell), bytes + commit_parts * frame_size);
+	encode(shot_frame(ship_cell), bytes + (commit_parts + 1) * frame_size);
+	CHECK(send(peer, bytes, sizeof(bytes), 0) == ssize_t(sizeof(bytes)));
+
+	Coord shot = opponent.take_shot();
+	CHECK(shot.x == ship_cell.x && shot.y == ship_cell.y);
+	CHECK(local.get_shot(shot) != ShotRes::miss);
+	bool rejected = false;
+	try {
+		opponent.take_shot();
+	} catch (const NetworkError&) {
+		rejected = true;
+	}
+	CHECK(rejected);
+
+	close(peer);
+	close(server);
+
+	// a layout with a cell past the field, in row 10 clear of the last
+	// row's ships, is no fleet however the rest of it looks
+	Rng rng(3);
+	Bitboard ships[fleet_size];
+	random_fleet(rng, ships);
+	Bitboard layout;
+	for (const Bitboard &ship : ships) {
+		layout |= ship;
+	}
+	CHECK(revealed_verified(layout));
+	int x = 0;
+	while (x < 10 && (dilate4(Bitboard::bit(90 + x)) & layout).any()) {
+		x++;
+	}
+	CHECK(x < 10);
+	Bitboard cheat = layout;
+	cheat.hi |= uint64_t(1) << (100 + x - 64);
+	CHECK(!revealed_verified(cheat));
+	cheat = layout & ~ships[fleet_size - 1];
+	cheat.hi |= uint64_t(1) << (100 + x - 64);
+	CHECK(!revealed_verified(cheat));
+}
+
+void decode_fuzz() {
+	Rng rng(4);
+	std::vector<uint8_t> bytes;
+	for (int i = 0; i < 20000; i++) {
+		bytes.resize(rng.below(64 * frame_size));
+		for (uint8_t &b : bytes) {
+			b = uint8_t(rng());
+		}
+		LLVMFuzzerTestOneInput(bytes.data(), bytes.size());
+	}
+}
+
+void record_round_trip() {
+	std::vector<uint8_t> bytes;
+	for (uint64_t i = 0; i < 200; i++) {
+		HardPlayer bot1(stream_seed(7, 2 * i));
+		MiddlePlayer bot2(stream_seed(7, 2 * i + 1));
+		MatchResult res = play_match(bot1, bot2);
+
+		bytes.clear();
+		CHECK(encode_record(bot1.field_m, bot2.field_m, res.log, bytes));
+		GameRecord record{bytes.data()};
+		CHECK(record.size() == bytes.size());
+		CHECK(record.shots() == int(res.log.size()));
+
+		const AbstractPlayer* players[2] = {&bot1, &bot2};
+		for (int player = 1; player <= 2; player++) {
+			Bitboard ships[fleet_size];
+			record.fleet(player, ships);
+			Bitboard all;
+			for (const Bitboard &ship : ships) {
+				all |= ship;
+			}
+			CHECK(all == players[player - 1]->field_m.ships);
+		}
+		for (int s = 0; s < record.shots(); s++) {
+			Coord shot = record.shot(s);
+			CHECK(shot.x == res.log[s].shot.x && shot.y == res.log[s].shot.y);
+			CHECK(record.missed(s) == (res.log[s].res == ShotRes::miss));
+		}
+
+		Replay replay;
+		CHECK(replay.load(record));
+		CHECK(replay.winner() == res.winner);
+		for (int s = 0; s < record.shots(); s++) {
+			CHECK(replay.shot(s).player == res.log[s].player && replay.shot(s).res == res.log[s].res);
+		}
+	}
+}
+
+void record_corrupt() {
+	HardPlayer bot1(1);
+	MiddlePlayer bot2(2);
+	MatchResult res = play_match(bot1, bot2);
+	std::vector<uint8_t> good;
+	CHECK(encode_record(bot1.field_m, bot2.field_m, res.log, good));
+	Replay replay;
+	CHECK(replay.load(GameRecord{good.data()}));
+
+	// a ship off the field
+	std::vector<uint8_t> bytes = good;
+	bytes[1] = 100;
+	CHECK(!replay.load(GameRecord{bytes.data()}));
+	bytes[1] = 0x7f;
+	CHECK(!replay.load(GameRecord{bytes.data()}));
+
+	// the four-cell ship wrapping onto the next row, or off the bottom
+	bytes = good;
+	bytes[1] = 8;
+	Bitboard ships[fleet_size];
+	CHECK(!GameRecord{bytes.data()}.fleet(1, ships));
+	CHECK(!replay.load(GameRecord{bytes.data()}));
+	bytes[1] = 0x80 | 70;
+	CHECK(!replay.load(GameRecord{bytes.data()}));
+
+	// a shot off the field
+	for (int i = 0; i < res.shots; i++) {
+		bytes = good;
+		bytes[record_header + i] = (bytes[record_header + i] & 0x80) | (100 + i % 28);
+		CHECK(!replay.load(GameRecord{bytes.data()}));
+	}
+}
+
+void cache_file() {
+	PositionCache cache(4096);
+	Rng rng(6);
+	std::vector<uint64_t> keys;
+	for (int i = 0; i < 1000; i++) {
+		uint64_t key = rng();
+		int cell;
+		if (!cache.lookup(key, cell)) {
+			cache.store(key, int(key % 100));
+			keys.push_back(key);
+		}
+	}
+
+	// only the filled slots go to the file
+	const char* path = "battleship-tests.cache";
+	CHECK(cache.save(path));
+	struct stat st;
+	CHECK(stat(path, &st) == 0);
+	int filled = 0;
+	for (uint64_t key : keys) {
+		int cell;
+		filled += cache.lookup(key, cell);
+	}
+	CHECK(size_t(st.st_size) == 16 + 9 * size_t(filled));
+
+	// into a cache of another size, the entries that land apart come back
+	PositionCache bigger(1 << 16);
+	CHECK(bigger.load(path));
+	for (uint64_t key : keys) {
+		int cell;
+		int loaded;
+		if (cache.lookup(key, cell)) {
+			CHECK(bigger.lookup(key, loaded) && loaded == cell);
+		}
+	}
+
+	// a cut file is rejected
+	CHECK(truncate(path, st.st_size - 1) == 0);
+	PositionCache cut;
+	CHECK(!cut.load(path));
+	remove(path);
+}
+
+// the same game through play_match with the bots' own types and through
+// the vtable, turn by turn
+void typed_matches_virtual() {
+	const char* names[] = {"easy", "middle", "hard", "tuned"};
+	for (const char* name1 : names) {
+		for (const char* name2 : names) {
+			for (uint64_t i = 0; i < 20; i++) {
+				uint64_t seed1 = stream_seed(8, 2 * i);
+				uint64_t seed2 = stream_seed(8, 2 * i + 1);
+				std::unique_ptr<AbstractPlayer> virtual1 = make_bot(name1, seed1);
+				std::unique_ptr<AbstractPlayer> virtual2 = make_bot(name2, seed2);
+				MatchResult expected = run_match(*virtual1, *virtual2);
+
+				visit_bot(name1, [&](auto* b1) {
+					visit_bot(name2, [&](auto* b2) {
+						std::remove_pointer_t<decltype(b1)> bot1(seed1);
+						std::remove_pointer_t<decltype(b2)> bot2(seed2);
+						MatchResult res = play_match(bot1, bot2);
+						CHECK(res.winner == expected.winner && res.log.size() == expected.log.size());
+						for (size_t t = 0; t < res.log.size() && t < expected.log.size(); t++) {
+							CHECK(res.log[t].player == expected.log[t].player && res.log[t].res == expected.log[t].res
+								&& res.log[t].shot.x == expected.log[t].shot.x
+								&& res.log[t].shot.y == expected.log[t].shot.y);
+						}
+					});
+				});
+			}
+		}
+	}
+}
+
+void batch_matches_play_match() {
+	const uint64_t seed = 11;
+	const uint64_t games = 2000;
+	std::vector<GameOutcome> out(games);
+	play_easy_games(seed, 0, games, out.data());
+	std::vector<GameOutcome> scalar(games);
+	play_easy_games_scalar(seed, 0, games, scalar.data());
+
+	for (uint64_t i = 0; i < games; i++) {
+		EasyPlayer bot1(stream_seed(seed, 2 * i));
+		EasyPlayer bot2(stream_seed(seed, 2 * i + 1));
+		bool swapped = i % 2 == 1;
+		MatchResult res = swapped ? play_match(bot2, bot1, false) : play_match(bot1, bot2, false);
+		int winner = swapped ? 3 - res.winner : res.winner;
+		CHECK(out[i].winner == winner && out[i].shots == res.shots);
+		CHECK(scalar[i].winner == winner && scalar[i].shots == res.shots);
+	}
+
+	// a range that doesn't start at a multiple of the lane count
+	std::vector<GameOutcome> tail(games - 37);
+	play_easy_games(seed, 37, games, tail.data());
+	for (uint64_t i = 37; i < games; i++) {
+		CHECK(tail[i - 37].winner == out[i].winner && tail[i - 37].shots == out[i].shots);
+	}
+}
+
+// the tournament's split of the games over threads and chunks doesn't
+// change a game, and the AVX2 loop plays the same games as the scalar one
+void batch_threads() {
+	const uint64_t seed = 12;
+	const uint64_t games = 5000;
+	std::vector<GameOutcome> serial(games);
+	play_easy_games_scalar(seed, 0, games, serial.data());
+
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")) {
+		std::vector<GameOutcome> avx2(games);
+		play_easy_games_avx2(seed, 0, games, avx2.data());
+		for (uint64_t i = 0; i < games; i++) {
+			CHECK(avx2[i].winner == serial[i].winner && avx2[i].shots == serial[i].shots);
+		}
+	}
+
+	for (int threads : {1, 3, 8}) {
+		for (uint64_t chunk : {1, 7, 256}) {
+			std::vector<GameOutcome> out(games);
+			parallel_for(games, threads, chunk, [&](int, uint64_t begin, uint64_t end) {
+				play_easy_games(seed, begin, end, out.data() + begin);
+			});
+			for (uint64_t i = 0; i < games; i++) {
+				CHECK(out[i].winner == serial[i].winner && out[i].shots == serial[i].shots);
+			}
+		}
+	}
+}
+
+// random layouts in batches of odd sizes and across the flush of the
+// bit-sliced counters, added to counts that already hold something
+void accumulate_matches_scalar() {
+	Rng rng(13);
+	std::vector<Bitboard> layouts(140001);
+	for (size_t i = 0; i < layouts.size(); i++) {
+		if (i % 2 == 0) {
+			Bitboard ships[fleet_size];
+			random_fleet(rng, ships);
+			for (const Bitboard &ship : ships) {
+				layouts[i] |= ship;
+			}
+		} else {
+			layouts[i].lo = rng();
+			layouts[i].hi = rng() & Bitboard::hi_mask;
+		}
+	}
+
+	for (size_t n : {size_t(0), size_t(1), size_t(2), size_t(3), size_t(17), size_t(1001),
+			size_t(65535), size_t(65536), size_t(131071), layouts.size()}) {
+		uint32_t start[100];
+		for (uint32_t &c : start) {
+			c = uint32_t(rng.below(1000));
+		}
+		uint32_t plain[100];
+		std::copy(start, start + 100, plain);
+		for (size_t i = 0; i < n; i++) {
+			for (int cell = 0; cell < 100; cell++) {
+				plain[cell] += layouts[i].test(cell);
+			}
+		}
+
+		uint32_t scalar[100];
+		std::copy(start, start + 100, scalar);
+		accumulate_scalar(layouts.data(), n, scalar);
+		CHECK(std::equal(scalar, scalar + 100, plain));
+
+		uint32_t dispatched[100];
+		std::copy(start, start + 100, dispatched);
+		accumulate(layouts.data(), n, dispatched);
+		CHECK(std::equal(dispatched, dispatched + 100, plain));
+
+		if (__builtin_cpu_supports("avx2")) {
+			uint32_t avx2[100];
+			std::copy(start, start + 100, avx2);
+			accumulate_avx2(layouts.data(), n, avx2);
+			CHECK(std::equal(avx2, avx2 + 100, plain));
+		}
+	}
+}
+
+// calls of 1..10000 ns from several threads, some of which end before the
+// dump; half of them name the player with another copy of the string
+void metrics_histograms() {
+	enable_metrics();
+	static const char copy[] = "metrics-test";
+	const int threads = 4;
+	const uint64_t per_thread = 10000;
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++) {
+		workers.emplace_back([=] {
+			const char* who = t % 2 == 0 ? "metrics-test" : copy;
+			for (uint64_t ns = 1; ns <= per_thread; ns++) {
+				record_call(Call::get_res, who, ns);
+			}
+		});
+	}
+	for (std::thread &w : workers) {
+		w.join();
+	}
+
+	std::string json = metrics_json();
+	size_t row = json.find("\"call\": \"get_res\", \"player\": \"metrics-test\"");
+	CHECK(row != std::string::npos);
+	if (row == std::string::npos) {
+		return;
+	}
+	unsigned long long count, p50, p90, p99, p999, max;
+	double mean;
+	int fields = sscanf(json.c_str() + json.find("\"count\"", row),
+		"\"count\": %llu, \"mean_ns\": %lf, \"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu,"
+		" \"p999_ns\": %llu, \"max_ns\": %llu", &count, &mean, &p50, &p90, &p99, &p999, &max);
+	CHECK(fields == 7);
+	CHECK(count == threads * per_thread);
+	CHECK(mean > 5000 && mean < 5001);
+	CHECK(max == per_thread);
+	// a bucket is at most 12.5% wide
+	auto near = [](unsigned long long got, double want) {
+		return got >= want * 0.875 && got <= want * 1.125;
+	};
+	CHECK(near(p50, 5000));
+	CHECK(near(p90, 9000));
+	CHECK(near(p99, 9900));
+	CHECK(near(p999, 9990));
+
+	// the cumulative buckets end with all the calls
+	std::string prometheus = metrics_prometheus();
+	std::string last = "battleship_call_seconds_bucket{call=\"get_res\",player=\"metrics-test\",le=\"+Inf\"} "
+		+ std::to_string(threads * per_thread) + "\n";
+	CHECK(prometheus.find(last) != std::string::npos);
+}
+
+// the layouts of the ships of the given lengths (longest first) that agree
+// with the view, as the cells they cover; ships of one length are placed
+// in the order of their cells, so every layout comes once
+void list_layouts(const Board &view, const std::vector<int> &lens, size_t i, int after, Bitboard placed,
+		std::vector<Bitboard> &out) {
+	if (i == lens.size()) {
+		if ((view.hits & ~view.sunk & ~placed).empty()) {
+			out.push_back(placed);
+		}
+		return;
+	}
+	int len = lens[i];
+	int first = i > 0 && lens[i - 1] == len ? after + 1 : 0;
+	for (int cell = first; cell < 100; cell++) {
+		for (int orientation = 0; orientation < (len == 1 ? 1 : 2); orientation++) {
+			int x = cell % 10;
+			int y = cell / 10;
+			if ((orientation == 0 ? x : y) + len > 10) {
+				continue;
+			}
+			Bitboard ship = ship_mask(len, x, y, orientation);
+			if ((ship & (view.misses | view.sunk | view.halo | placed | halo(placed))).empty()) {
+				list_layouts(view, lens, i + 1, cell, placed | ship, out);
+			}
+		}
+	}
+}
+
+// plain expectimax over the layouts, every one equally likely
+struct NaiveEndgame {
+	std::vector<Bitboard> layouts;
+	std::map<std::tuple<std::vector<int>, uint64_t, uint64_t>, double> memo;
+
+	// expected shots to sink the rest, and the value of every first shot
+	double value(const std::vector<int> &set, Bitboard shot, double* first = nullptr) {
+		Bitboard cover;
+		for (int l : set) {
+			cover |= layouts[l];
+		}
+		shot = shot & cover;
+		auto key = std::make_tuple(set, shot.lo, shot.hi);
+		auto found = memo.find(key);
+		if (found != memo.end() && first == nullptr) {
+			return found->second;
+		}
+
+		double best = 1e9;
+		for (Bitboard cells = cover & ~shot; cells.any(); ) {
+			int c = cells.pop();
+			Bitboard next = shot | Bitboard::bit(c);
+			// the layouts split by what the shot shows: a miss, a hit, the
+			// ship sunk, or the end of the game
+			std::map<std::tuple<int, uint64_t, uint64_t>, std::vector<int>> groups;
+			for (int l : set) {
+				Bitboard layout = layouts[l];
+				if (!layout.test(c)) {
+					groups[std::make_tuple(0, uint64_t(0), uint64_t(0))].push_back(l);
+					continue;
+				}
+				if ((layout & ~next).empty()) {
+					groups[std::make_tuple(3, uint64_t(0), uint64_t(0))].push_back(l);
+					continue;
+				}
+				Bitboard ship = Bitboard::bit(c);
+				for (Bitboard grown = dilate4(ship) & layout; grown != ship; grown = dilate4(ship) & layout) {
+					ship = grown;
+				}
+				bool sank = (ship & ~next).empty();
+				groups[std::make_tuple(sank ? 2 : 1, sank ? ship.lo : 0, sank ? ship.hi : 0)].push_back(l);
+			}
+			double v = 1;
+			for (auto &group : groups) {
+				if (std::get<0>(group.first) != 3) {
+					v += double(group.second.size()) / set.size() * value(group.second, next);
+				}
+			}
+			if (first != nullptr) {
+				first[c] = v;
+			}
+			best = std::min(best, v);
+		}
+		memo[key] = best;
+		return best;
+	}
+};
+
+// views from hard's games, solved with one thread and with four and
+// against the plain expectimax
+void endgame_exact() {
+	int solved = 0;
+	for (uint64_t game = 0; game < 400 && solved < 150; game++) {
+		HardPlayer bot(stream_seed(9, 2 * game));
+		EasyPlayer target(stream_seed(9, 2 * game + 1));
+		bot.arrange_ships();
+		target.arrange_ships();
+
+		while (target.field_m.alive_ships_num > 0) {
+			int remaining[5] = {};
+			std::vector<int> lens;
+			for (int i = 0; i < target.field_m.ship_num; i++) {
+				Bitboard ship = target.field_m.fleet[i];
+				if ((ship & ~target.field_m.sunk).any()) {
+					remaining[ship.count()]++;
+					lens.push_back(ship.count());
+				}
+			}
+			std::sort(lens.rbegin(), lens.rend());
+
+			EndgameResult one = solve_endgame(bot.other_field_m, remaining, EndgameLimits{10, 1, 0});
+			if (one.cell != -1 && one.layouts > 1) {
+				EndgameResult four = solve_endgame(bot.other_field_m, remaining, EndgameLimits{10, 4, 0});
+				CHECK(four.cell == one.cell && four.expected == one.expected && four.layouts == one.layouts);
+
+				NaiveEndgame naive;
+				list_layouts(bot.other_field_m, lens, 0, 0, Bitboard(), naive.layouts);
+				CHECK(int(naive.layouts.size()) == one.layouts);
+				std::vector<int> all(naive.layouts.size());
+				for (size_t l = 0; l < all.size(); l++) {
+					all[l] = int(l);
+				}
+				double first[100];
+				std::fill(first, first + 100, 1e9);
+				double best = naive.value(all, bot.other_field_m.shot(), first);
+				CHECK(std::abs(one.expected - best) < 1e-3);
+				// the shot is one of the best, ties may be broken either way
+				CHECK(std::abs(first[one.cell] - best) < 1e-3);
+				solved++;
+			}
+
+			Coord shot = bot.take_shot();
+			bot.get_res(target.get_shot(shot), shot);
+		}
+	}
+	CHECK(solved >= 150);
+}
+
+void weights_file() {
+	const char* path = "battleship-tests.weights";
+	Weights saved = weights_of({0.1, -0.3, 1.0 / 3});
+	CHECK(saved.save(path));
+	Weights loaded;
+	CHECK(loaded.load(path));
+	for (int i = 0; i < features_num; i++) {
+		CHECK(loaded.w[i] == saved.w[i]);
+	}
+
+	// an unknown name fails and leaves the weights as they were
+	FILE* out = fopen(path, "w");
+	fprintf(out, "# hand written\nparity 0.5\nspeed 2\n");
+	fclose(out);
+	CHECK(!loaded.load(path));
+	CHECK(loaded[Feature::parity] == saved[Feature::parity]);
+	unlink(path);
+}
+
+// the search finds the bottom of a bowl, and moves bad weights towards
+// fewer shots
+void cmaes_converges() {
+	Vector target = {1, -2, 0.5};
+	Cmaes bowl(Vector(3, 0.0), 0.3, 8);
+	Rng rng(stream_seed(3, 0));
+	for (int g = 0; g < 200; g++) {
+		std::vector<Vector> xs = bowl.ask(rng);
+		Vector fitness;
+		for (const Vector &x : xs) {
+			double f = 0;
+			for (int d = 0; d < 3; d++) {
+				f += (x[d] - target[d]) * (x[d] - target[d]);
+			}
+			fitness.push_back(f);
+		}
+		bowl.tell(xs, fitness);
+	}
+	for (int d = 0; d < 3; d++) {
+		CHECK(std::abs(bowl.mean[d] - target[d]) < 1e-3);
+	}
+
+	Vector bad = {-1, -1, 1};
+	Cmaes search(bad, 0.3, 8);
+	for (int g = 0; g < 8; g++) {
+		std::vector<Vector> xs = search.ask(rng);
+		std::vector<Weights> candidates;
+		for (const Vector &x : xs) {
+			candidates.push_back(weights_of(x));
+		}
+		search.tell(xs, evaluate(candidates, stream_seed(4, g), 100, 4));
+	}
+	Vector shots = evaluate({weights_of(bad), weights_of(search.mean)}, stream_seed(5, 0), 1000, 4);
+	CHECK(shots[1] < shots[0] - 1);
+}
+
+// fleets kept away from where hard shoots first are cooler than random
+// ones, the same on any number of threads, and hard sinks them later
+void heatmap_arrange() {
+	Heatmap heat;
+	CHECK(!measure_heatmap("nobody", 1, 10, 1, heat));
+	CHECK(measure_heatmap("hard", 1, 2000, 4, heat));
+
+	// a single candidate is a plain random fleet
+	long random_score = 0;
+	long cool_score = 0;
+	for (uint64_t i = 0; i < 100; i++) {
+		Bitboard one[fleet_size];
+		Bitboard four[fleet_size];
+		Bitboard plain[fleet_size];
+		Rng rng_one(stream_seed(7, i));
+		Rng rng_four(stream_seed(7, i));
+		Rng rng_plain(stream_seed(8, i));
+		arrange_against(heat, rng_one, 1000, 1, one);
+		arrange_against(heat, rng_four, 1000, 4, four);
+		arrange_against(heat, rng_plain, 1, 1, plain);
+		Bitboard layout;
+		Bitboard layout_plain;
+		for (int s = 0; s < fleet_size; s++) {
+			CHECK(one[s] == four[s]);
+			CHECK(one[s].count() == fleet_lens[s]);
+			layout |= one[s];
+			layout_plain |= plain[s];
+		}
+		cool_score += heat.score(layout);
+		random_score += heat.score(layout_plain);
+	}
+	CHECK(cool_score < random_score * 3 / 4);
+
+	// seats swap every game, as in the tournament
+	int games = 400;
+	int wins = 0;
+	for (int i = 0; i < games; i++) {
+		HardPlayer bot1(stream_seed(10, 2 * i));
+		HardPlayer bot2(stream_seed(10, 2 * i + 1));
+		bot2.avoid = &heat;
+		MatchResult res = i % 2 == 1 ? play_match(bot2, bot1, false) : play_match(bot1, bot2, false);
+		wins += (i % 2 == 1 ? 3 - res.winner : res.winner) == 2;
+	}
+	CHECK(wins > games * 60 / 100);
+}
+
+template <typename Bot1, typename Bot2>
+void check_classic(const char* bot1, const char* bot2) {
+	const uint64_t seed = 5;
+	const uint64_t games = 500;
+	std::vector<GameOutcome> out(games);
+	CHECK(find_variant("classic")->play(bot1, bot2, seed, 0, games, out.data()));
+	for (uint64_t i = 0; i < games; i++) {
+		Bot1 b1(stream_seed(seed, 2 * i));
+		Bot2 b2(stream_seed(seed, 2 * i + 1));
+		bool swapped = i % 2 == 1;
+		MatchResult res = swapped ? play_match(b2, b1, false) : play_match(b1, b2, false);
+		CHECK(out[i].winner == (swapped ? 3 - res.winner : res.winner) && out[i].shots == res.shots);
+	}
+}
+
+void classic_variant() {
+	check_classic<EasyPlayer, EasyPlayer>("easy", "easy");
+	check_classic<MiddlePlayer, EasyPlayer>("middle", "easy");
+	check_classic<MiddlePlayer, MiddlePlayer>("middle", "middle");
+}
+
+void touching_sunk() {
+	using Touching = Rules<10, 10, true, 4, 3, 3, 2, 2, 2, 1, 1, 1, 1>;
+	// the middle bot's sunk cells are always cells of ships that are sunk;
+	// the hits around a ship can be of other ships, so some stay open
+	int marked = 0;
+	for (uint64_t i = 0; i < 2000; i++) {
+		VariantMiddle<Touching> shooter(stream_seed(3, 2 * i));
+		VariantEasy<Touching> target(stream_seed(3, 2 * i + 1));
+		shooter.arrange_ships();
+		target.arrange_ships();
+		ShotRes res;
+		do {
+			Coord shot = shooter.take_shot();
+			res = target.get_shot(shot);
+			shooter.get_res(res, shot);
+			CHECK((shooter.other_field_m.sunk & ~target.field_m.sunk).empty());
+		} while (res != ShotRes::game_over);
+		marked += shooter.other_field_m.sunk.count();
+	}
+	// most sunk cells are still recognized
+	CHECK(marked > 2000 * 8);
+
+	const uint64_t games = 2000;
+	std::vector<GameOutcome> out(games);
+	CHECK(find_variant("touching")->play("middle", "easy", 3, 0, games, out.data()));
+	int wins = 0;
+	for (const GameOutcome &o : out) {
+		wins += o.winner == 1;
+	}
+	printf("touching: middle beats easy in %d of %d games, %d of %d ship cells marked sunk\n", wins,
+		int(games), marked, int(2000 * 20));
+	// touching fleets are found later, even knowing the sunk cells exactly
+	// middle needs about 85 shots against 57 in the classic rules
+	CHECK(wins > int(games * 78 / 100));
+}
+
+struct Test {
+	const char* name;
+	void (*run)();
+};
+
+const Test tests[] = {
+	{"protocol_round_trip", protocol_round_trip},
+	{"placement_table_layout", placement_table_layout},
+	{"sample_ships_chi_square", sample_ships_chi_square},
+	{"commitment", commitment},
+	{"link_framing", link_framing},
+	{"repeated_shot", repeated_shot},
+	{"decode_fuzz", decode_fuzz},
+	{"record_round_trip", record_round_trip},
+	{"record_corrupt", record_corrupt},
+	{"cache_file", cache_file},
+	{"typed_matches_virtual", typed_matches_virtual},
+	{"batch_matches_play_match", batch_matches_play_match},
+	{"batch_threads", batch_threads},
+	{"accumulate_matches_scalar", accumulate_matches_scalar},
+	{"metrics_histograms", metrics_histograms},
+	{"endgame_exact", endgame_exact},
+	{"weights_file", weights_file},
+	{"cmaes_converges", cmaes_converges},
+	{"heatmap_arrange", heatmap_arrange},
+	{"classic_variant", classic_variant},
+	{"touching_sunk", touching_sunk},
+};
+
+}
+
+int main(int argc, char** argv) {
+	int ran = 0;
+	for (const Test &test : tests) {
+		bool wanted = argc < 2;
+		for (int i = 1; i < argc; i++) {
+			wanted |= strcmp(argv[i], test.name) == 0;
+		}
+		if (!wanted) {
+			continue;
+		}
+		int before = failures;
+		test.run();
+		printf("%s: %s\n", test.name, failures == before ? "ok" : "FAILED");
+		ran++;
+	}
+	if (ran == 0) {
+		fprintf(stderr, "no such test\n");
+		return 2;
+	}
+	return failures == 0 ? 0 : 1;
+}
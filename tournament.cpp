@@ -0,0 +1,325 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "batch.h"
+#include "bots.h"
+#include "cache.h"
+#include "metrics.h"
+#include "pool.h"
+#include "record.h"
+#include "rng.h"
+#include "sim.h"
+#include "variant.h"
+
+namespace {
+
+// the longest game of the largest variant, 16x16
+const int max_shots = 512;
+
+struct Pairing {
+	std::string bot1;
+	std::string bot2;
+};
+
+// what hard, mc and tuned get besides their seed
+struct BotSetup {
+	PositionCache* cache = nullptr;
+	EndgameLimits endgame;
+	Weights weights;
+	// bot 2 of every pairing arranges its fleet against it
+	const Heatmap* avoid = nullptr;
+};
+
+// results of one worker, merged once all workers are done
+struct alignas(64) Stats {
+	uint64_t games = 0;
+	uint64_t wins[2] = {0, 0};
+	uint64_t shots = 0;
+	uint64_t histogram[max_shots + 1] = {};
+
+	void add(const GameOutcome* out, uint64_t n) {
+		for (uint64_t i = 0; i < n; i++) {
+			games++;
+			wins[out[i].winner - 1]++;
+			shots += out[i].shots;
+			histogram[out[i].shots < max_shots ? out[i].shots : max_shots]++;
+		}
+	}
+
+	void merge(const Stats &other) {
+		games += other.games;
+		wins[0] += other.wins[0];
+		wins[1] += other.wins[1];
+		shots += other.shots;
+		for (int i = 0; i <= max_shots; i++) {
+			histogram[i] += other.histogram[i];
+		}
+	}
+};
+
+void usage() {
+	fprintf(stderr,
+		"usage: battleship-tournament [-n games] [-t threads] [-s seed] [-c cache] [-e layouts] [-r records]"
+		" [-w weights] [-a bot] [-m metrics] [-v variant] [bot1:bot2 ...]\n"
+		"bots: easy, middle, hard, mc, tuned\n"
+		"-c loads the position cache of hard and mc from the file and saves it back\n"
+		"-e lets hard and mc solve the endgame exactly once it has at most that many layouts\n"
+		"-r appends every game to the record file\n"
+		"-w loads the weights of tuned from the file battleship-train wrote\n"
+		"-a measures where the bot shoots first, bot 2 of every pairing then keeps its fleet away from there\n"
+		"-m writes the latency of the bots' calls to the file, as JSON if it ends with .json\n"
+		"-v plays by other rules, with easy and middle only:\n%s", list_variants().c_str());
+}
+
+template <typename Bot>
+void set_up(Bot &bot, const BotSetup &setup) {
+	if constexpr (std::is_base_of<HardPlayer, Bot>::value) {
+		bot.cache = setup.cache;
+		bot.endgame = setup.endgame;
+	}
+	if constexpr (std::is_same<Bot, WeightedPlayer>::value) {
+		bot.weights = setup.weights;
+	}
+}
+
+// easy against easy without records or metrics goes to the batched
+// engine, which plays the very same games
+void play_easy_batch(uint64_t seed, uint64_t begin, uint64_t end, Stats &stats) {
+	GameOutcome out[1024];
+	for (; begin < end; begin += 1024) {
+		uint64_t n = end - begin < 1024 ? end - begin : 1024;
+		play_easy_games(seed, begin, begin + n, out);
+		stats.add(out, n);
+	}
+}
+
+void play_variant_games(const Variant &variant, const Pairing &pairing, uint64_t seed, uint64_t begin,
+		uint64_t end, Stats &stats) {
+	GameOutcome out[1024];
+	for (; begin < end; begin += 1024) {
+		uint64_t n = end - begin < 1024 ? end - begin : 1024;
+		variant.play(pairing.bot1, pairing.bot2, seed, begin, begin + n, out);
+		stats.add(out, n);
+	}
+}
+
+// game i uses seeds derived from (seed, pairing, i) only, so the results
+// don't depend on the number of threads or on how the work got split;
+// odd games swap the seats so that neither bot always shoots first.
+// The bots are of concrete types, so play_match calls them directly
+template <typename Bot1, typename Bot2>
+void play_games(uint64_t seed, const BotSetup &setup, RecordWriter* records,
+		uint64_t begin, uint64_t end, Stats &stats) {
+	if constexpr (std::is_same<Bot1, EasyPlayer>::value && std::is_same<Bot2, EasyPlayer>::value) {
+		if (records == nullptr && !metrics_enabled() && setup.avoid == nullptr) {
+			play_easy_batch(seed, begin, end, stats);
+			return;
+		}
+	}
+
+	std::vector<uint8_t> encoded;
+	for (uint64_t i = begin; i < end; i++) {
+		Bot1 bot1(stream_seed(seed, 2 * i));
+		Bot2 bot2(stream_seed(seed, 2 * i + 1));
+		set_up(bot1, setup);
+		set_up(bot2, setup);
+		bot2.avoid = setup.avoid;
+		bool swapped = i % 2 == 1;
+
+		bool keep_log = records != nullptr;
+		MatchResult res = swapped ? play_match(bot2, bot1, keep_log) : play_match(bot1, bot2, keep_log);
+		int winner = swapped ? 3 - res.winner : res.winner;
+		if (records != nullptr) {
+			// the record's player 1 is the one who shot first
+			encode_record(swapped ? bot2.field_m : bot1.field_m, swapped ? bot1.field_m : bot2.field_m,
+				res.log, encoded);
+		}
+
+		stats.games++;
+		stats.wins[winner - 1]++;
+		stats.shots += res.shots;
+		stats.histogram[res.shots < max_shots ? res.shots : max_shots]++;
+	}
+	if (records != nullptr) {
+		records->write(encoded);
+	}
+}
+
+using PlayGames = void (*)(uint64_t, const BotSetup&, RecordWriter*, uint64_t, uint64_t, Stats&);
+
+// play_games for the pairing, nullptr if a bot is unknown
+PlayGames games_of(const Pairing &pairing) {
+	PlayGames games = nullptr;
+	visit_bot(pairing.bot1, [&](auto* bot1) {
+		visit_bot(pairing.bot2, [&](auto* bot2) {
+			games = play_games<std::remove_pointer_t<decltype(bot1)>, std::remove_pointer_t<decltype(bot2)>>;
+		});
+	});
+	return games;
+}
+
+void print_stats(const Pairing &pairing, const Stats &stats, double seconds) {
+	printf("%s vs %s: %llu games in %.2fs (%.0f games/s)\n", pairing.bot1.c_str(), pairing.bot2.c_str(),
+		(unsigned long long)stats.games, seconds, stats.games / seconds);
+	printf("  %s wins %.2f%%, %s wins %.2f%%, %.2f shots per game\n",
+		pairing.bot1.c_str(), 100.0 * stats.wins[0] / stats.games,
+		pairing.bot2.c_str(), 100.0 * stats.wins[1] / stats.games,
+		double(stats.shots) / stats.games);
+	printf("  shots per game histogram:\n");
+	for (int i = 0; i <= max_shots; i++) {
+		if (stats.histogram[i] != 0) {
+			printf("  %3d %llu\n", i, (unsigned long long)stats.histogram[i]);
+		}
+	}
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	uint64_t games = 100000;
+	int threads = default_threads();
+	uint64_t seed = 1;
+	const char* cache_path = nullptr;
+	int endgame_layouts = 0;
+	const char* records_path = nullptr;
+	const char* weights_path = nullptr;
+	const char* avoid_bot = nullptr;
+	const char* metrics_path = nullptr;
+	const Variant* variant = nullptr;
+	std::vector<Pairing> pairings;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			games = strtoull(argv[++i], nullptr, 10);
+		} else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			seed = strtoull(argv[++i], nullptr, 10);
+		} else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+			cache_path = argv[++i];
+		} else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+			endgame_layouts = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			records_path = argv[++i];
+		} else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+			weights_path = argv[++i];
+		} else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+			avoid_bot = argv[++i];
+		} else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
+			variant = find_variant(argv[++i]);
+			if (variant == nullptr) {
+				fprintf(stderr, "unknown variant %s\n", argv[i]);
+				usage();
+				return 1;
+			}
+		} else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+			metrics_path = argv[++i];
+			enable_metrics();
+		} else if (const char* colon = strchr(argv[i], ':')) {
+			pairings.push_back(Pairing{std::string(argv[i], colon - argv[i]), std::string(colon + 1)});
+		} else {
+			usage();
+			return 1;
+		}
+	}
+
+	if (pairings.empty()) {
+		pairings.push_back(Pairing{"easy", "easy"});
+	}
+	if (games == 0 || games > 0xffffffffULL) {
+		fprintf(stderr, "the number of games must be between 1 and 2^32 - 1\n");
+		return 1;
+	}
+
+	std::unique_ptr<PositionCache> cache;
+	if (cache_path != nullptr) {
+		cache = std::make_unique<PositionCache>();
+		if (cache->load(cache_path)) {
+			printf("loaded the position cache from %s\n", cache_path);
+		}
+	}
+
+	// one thread per game and no time limit, the games stay reproducible
+	BotSetup setup;
+	setup.cache = cache.get();
+	setup.endgame.max_layouts = endgame_layouts;
+	if (weights_path != nullptr && !setup.weights.load(weights_path)) {
+		fprintf(stderr, "can't read the weights from %s\n", weights_path);
+		return 1;
+	}
+
+	Heatmap heatmap;
+	if (avoid_bot != nullptr && variant != nullptr) {
+		fprintf(stderr, "the heatmaps are of 10x10 games only, -a can't be used with -v\n");
+		return 1;
+	}
+	if (avoid_bot != nullptr) {
+		const uint64_t heatmap_games = 2000;
+		if (!measure_heatmap(avoid_bot, stream_seed(seed, ~uint64_t(0)), heatmap_games, threads, heatmap)) {
+			fprintf(stderr, "unknown bot %s\n", avoid_bot);
+			usage();
+			return 1;
+		}
+		printf("measured the heatmap of %s in %llu games\n", avoid_bot, (unsigned long long)heatmap_games);
+		setup.avoid = &heatmap;
+	}
+
+	std::unique_ptr<RecordWriter> records;
+	if (records_path != nullptr && variant != nullptr) {
+		fprintf(stderr, "the record file holds 10x10 games only, -r can't be used with -v\n");
+		return 1;
+	}
+	if (records_path != nullptr) {
+		records = std::make_unique<RecordWriter>(records_path);
+		if (!records->ok()) {
+			fprintf(stderr, "can't open the record file %s\n", records_path);
+			return 1;
+		}
+	}
+
+	for (size_t p = 0; p < pairings.size(); p++) {
+		const Pairing &pairing = pairings[p];
+		PlayGames games_of_pairing = variant == nullptr ? games_of(pairing) : nullptr;
+		bool known = variant == nullptr ? games_of_pairing != nullptr
+			: variant->play(pairing.bot1, pairing.bot2, 0, 0, 0, nullptr);
+		if (!known) {
+			fprintf(stderr, "unknown bot in %s:%s\n", pairing.bot1.c_str(), pairing.bot2.c_str());
+			usage();
+			return 1;
+		}
+
+		std::vector<Stats> stats(threads > 0 ? threads : 1);
+		uint64_t pairing_seed = stream_seed(seed, p);
+
+		auto start = std::chrono::steady_clock::now();
+		parallel_for(games, threads, 256, [&](int worker, uint64_t begin, uint64_t end) {
+			if (variant != nullptr) {
+				play_variant_games(*variant, pairing, pairing_seed, begin, end, stats[worker]);
+			} else {
+				games_of_pairing(pairing_seed, setup, records.get(), begin, end, stats[worker]);
+			}
+		});
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		Stats total;
+		for (const Stats &s : stats) {
+			total.merge(s);
+		}
+		print_stats(pairing, total, elapsed.count());
+	}
+
+	if (cache && !cache->save(cache_path)) {
+		fprintf(stderr, "can't save the position cache to %s\n", cache_path);
+		return 1;
+	}
+	if (metrics_path != nullptr && !save_metrics(metrics_path)) {
+		fprintf(stderr, "can't write the metrics to %s\n", metrics_path);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include "pool.h"
+#include "tune.h"
+
+// Tunes the weights of the tuned bot with CMA-ES. Between two bots a game
+// is a race to sink the other's fleet first, so a candidate is scored by
+// the mean number of shots it needs against fleets of the usual random
+// arrangement, and the fewer the better. All candidates of a generation
+// play the same fleets with the same seeds (common random numbers): the
+// differences between them come from the weights, not from the luck of
+// the draw, and far fewer games tell them apart. Every generation draws
+// new fleets, so the weights don't fit one set of them.
+
+namespace {
+
+void usage() {
+	fprintf(stderr,
+		"usage: battleship-train [-g generations] [-p population] [-n games] [-t threads] [-s seed]"
+		" [-i weights] [-o weights]\n"
+		"-n is the number of games every candidate plays per generation\n"
+		"-i starts from the weights in the file instead of hard's\n"
+		"-o writes the weights found to the file, weights.txt by default\n");
+}
+
+void print_weights(const Weights &w) {
+	for (int i = 0; i < features_num; i++) {
+		printf(" %s %.3f", feature_name(Feature(i)), w.w[i]);
+	}
+	printf("\n");
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	int generations = 30;
+	int population = 8;
+	uint64_t games = 2000;
+	int threads = default_threads();
+	uint64_t seed = 1;
+	const char* start_path = nullptr;
+	const char* out_path = "weights.txt";
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+			generations = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+			population = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			games = strtoull(argv[++i], nullptr, 10);
+		} else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			seed = strtoull(argv[++i], nullptr, 10);
+		} else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+			start_path = argv[++i];
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			out_path = argv[++i];
+		} else {
+			usage();
+			return 1;
+		}
+	}
+
+	// the final check plays 4 times the games with 2 candidates
+	if (generations < 1 || population < 4 || games == 0 || games * std::max(population, 8) > 0xffffffffULL) {
+		fprintf(stderr, "at least 1 generation, 4 candidates and 1 game are needed,"
+			" games times candidates must fit into 32 bits\n");
+		return 1;
+	}
+
+	Weights start;
+	if (start_path != nullptr && !start.load(start_path)) {
+		fprintf(stderr, "can't read the weights from %s\n", start_path);
+		return 1;
+	}
+	if (start[Feature::density] <= 0) {
+		fprintf(stderr, "the density weight must be positive\n");
+		return 1;
+	}
+	Vector mean(tune_dims);
+	for (int d = 0; d < tune_dims; d++) {
+		mean[d] = start.w[d + 1] / start[Feature::density];
+	}
+
+	Cmaes cmaes(mean, 0.3, population);
+	Rng rng(stream_seed(seed, 0));
+	auto begin = std::chrono::steady_clock::now();
+
+	for (int g = 0; g < generations; g++) {
+		std::vector<Vector> xs = cmaes.ask(rng);
+		std::vector<Weights> candidates;
+		for (const Vector &x : xs) {
+			candidates.push_back(weights_of(x));
+		}
+		Vector fitness = evaluate(candidates, stream_seed(seed, g + 1), games, threads);
+		cmaes.tell(xs, fitness);
+
+		printf("generation %d: best %.3f shots, population %.3f, sigma %.4f, mean",
+			g + 1, *std::min_element(fitness.begin(), fitness.end()),
+			std::accumulate(fitness.begin(), fitness.end(), 0.0) / fitness.size(), cmaes.sigma);
+		print_weights(weights_of(cmaes.mean));
+		fflush(stdout);
+	}
+
+	// the mean against hard's weights on fleets no generation has seen
+	Weights tuned = weights_of(cmaes.mean);
+	Vector check = evaluate({tuned, Weights()}, stream_seed(seed, generations + 1), games * 4, threads);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+	printf("%.2fs, on %llu new fleets tuned needs %.3f shots, hard's weights %.3f\n", elapsed.count(),
+		(unsigned long long)(games * 4), check[0], check[1]);
+
+	if (!tuned.save(out_path)) {
+		fprintf(stderr, "can't write the weights to %s\n", out_path);
+		return 1;
+	}
+	printf("weights written to %s\n", out_path);
+	return 0;
+}
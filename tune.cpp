@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "pool.h"
+#include "tune.h"
+
+namespace {
+
+// lower triangular a with a * a^T = c, false if c isn't positive definite
+bool cholesky(const Matrix &c, Matrix &a) {
+	int n = c.size();
+	a.assign(n, Vector(n, 0.0));
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j <= i; j++) {
+			double sum = c[i][j];
+			for (int k = 0; k < j; k++) {
+				sum -= a[i][k] * a[j][k];
+			}
+			if (i == j) {
+				if (sum <= 0) {
+					return false;
+				}
+				a[i][i] = std::sqrt(sum);
+			} else {
+				a[i][j] = sum / a[j][j];
+			}
+		}
+	}
+	return true;
+}
+
+// x with a * x = y for lower triangular a
+Vector solve_lower(const Matrix &a, const Vector &y) {
+	int n = y.size();
+	Vector x(n);
+	for (int i = 0; i < n; i++) {
+		double sum = y[i];
+		for (int k = 0; k < i; k++) {
+			sum -= a[i][k] * x[k];
+		}
+		x[i] = sum / a[i][i];
+	}
+	return x;
+}
+
+double norm(const Vector &v) {
+	double sum = 0;
+	for (double x : v) {
+		sum += x * x;
+	}
+	return std::sqrt(sum);
+}
+
+}
+
+Weights weights_of(const Vector &x) {
+	Weights w;
+	for (int d = 0; d < tune_dims; d++) {
+		w.w[d + 1] = x[d];
+	}
+	return w;
+}
+
+int shots_to_sink(WeightedPlayer &bot, uint64_t fleet_seed) {
+	EasyPlayer target(fleet_seed);
+	target.arrange_ships();
+	bot.arrange_ships();
+
+	int shots = 0;
+	while (target.field_m.alive_ships_num > 0) {
+		Coord shot = bot.take_shot();
+		bot.get_res(target.get_shot(shot), shot);
+		shots++;
+	}
+	return shots;
+}
+
+Vector evaluate(const std::vector<Weights> &candidates, uint64_t seed, uint64_t games, int threads) {
+	uint64_t count = candidates.size();
+	std::vector<std::vector<uint64_t>> shots(threads > 0 ? threads : 1, std::vector<uint64_t>(count));
+
+	parallel_for(count * games, threads, 16, [&](int worker, uint64_t begin, uint64_t end) {
+		for (uint64_t t = begin; t < end; t++) {
+			uint64_t c = t / games;
+			uint64_t i = t % games;
+			WeightedPlayer bot(stream_seed(seed, 2 * i + 1), candidates[c]);
+			shots[worker][c] += shots_to_sink(bot, stream_seed(seed, 2 * i));
+		}
+	});
+
+	Vector mean(count);
+	for (uint64_t c = 0; c < count; c++) {
+		uint64_t sum = 0;
+		for (const std::vector<uint64_t> &s : shots) {
+			sum += s[c];
+		}
+		mean[c] = double(sum) / games;
+	}
+	return mean;
+}
+
+Cmaes::Cmaes(const Vector &mean, double sigma, int lambda) : mean(mean), sigma(sigma), lambda(lambda) {
+	int n = mean.size();
+	int mu = lambda / 2;
+	for (int i = 0; i < mu; i++) {
+		recombination.push_back(std::log(mu + 0.5) - std::log(i + 1.0));
+	}
+	double sum = 0;
+	double squares = 0;
+	for (double w : recombination) {
+		sum += w;
+	}
+	for (double &w : recombination) {
+		w /= sum;
+		squares += w * w;
+	}
+	mu_eff = 1 / squares;
+
+	c_sigma = (mu_eff + 2) / (n + mu_eff + 5);
+	d_sigma = 1 + 2 * std::max(0.0, std::sqrt((mu_eff - 1) / (n + 1)) - 1) + c_sigma;
+	c_c = (4 + mu_eff / n) / (n + 4 + 2 * mu_eff / n);
+	c_1 = 2 / ((n + 1.3) * (n + 1.3) + mu_eff);
+	c_mu = std::min(1 - c_1, 2 * (mu_eff - 2 + 1 / mu_eff) / ((n + 2) * (n + 2) + mu_eff));
+	expected_norm = std::sqrt(n) * (1 - 1.0 / (4 * n) + 1.0 / (21 * n * n));
+
+	p_sigma.assign(n, 0.0);
+	p_c.assign(n, 0.0);
+	c.assign(n, Vector(n, 0.0));
+	for (int i = 0; i < n; i++) {
+		c[i][i] = 1;
+	}
+	cholesky(c, a);
+}
+
+std::vector<Vector> Cmaes::ask(Rng &rng) {
+	int n = mean.size();
+	std::normal_distribution<double> normal;
+	std::vector<Vector> xs(lambda, Vector(n));
+	for (Vector &x : xs) {
+		Vector z(n);
+		for (double &v : z) {
+			v = normal(rng);
+		}
+		for (int i = 0; i < n; i++) {
+			double y = 0;
+			for (int k = 0; k <= i; k++) {
+				y += a[i][k] * z[k];
+			}
+			x[i] = mean[i] + sigma * y;
+		}
+	}
+	return xs;
+}
+
+void Cmaes::tell(const std::vector<Vector> &xs, const Vector &fitness) {
+	int n = mean.size();
+	int mu = recombination.size();
+	std::vector<int> order(lambda);
+	for (int k = 0; k < lambda; k++) {
+		order[k] = k;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](int i, int j) {
+		return fitness[i] < fitness[j];
+	});
+
+	Vector old = mean;
+	std::vector<Vector> steps(mu, Vector(n));
+	Vector step(n, 0.0);
+	for (int k = 0; k < mu; k++) {
+		for (int i = 0; i < n; i++) {
+			steps[k][i] = (xs[order[k]][i] - old[i]) / sigma;
+			step[i] += recombination[k] * steps[k][i];
+		}
+	}
+	for (int i = 0; i < n; i++) {
+		mean[i] = old[i] + sigma * step[i];
+	}
+
+	generation++;
+	Vector whitened = solve_lower(a, step);
+	for (int i = 0; i < n; i++) {
+		p_sigma[i] = (1 - c_sigma) * p_sigma[i] + std::sqrt(c_sigma * (2 - c_sigma) * mu_eff) * whitened[i];
+	}
+	double p_sigma_norm = norm(p_sigma);
+	bool h_sigma = p_sigma_norm / std::sqrt(1 - std::pow(1 - c_sigma, 2.0 * generation))
+		< (1.4 + 2.0 / (n + 1)) * expected_norm;
+	for (int i = 0; i < n; i++) {
+		p_c[i] = (1 - c_c) * p_c[i] + (h_sigma ? std::sqrt(c_c * (2 - c_c) * mu_eff) : 0.0) * step[i];
+	}
+
+	double lost = h_sigma ? 0.0 : c_c * (2 - c_c);
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j < n; j++) {
+			double rank_mu = 0;
+			for (int k = 0; k < mu; k++) {
+				rank_mu += recombination[k] * steps[k][i] * steps[k][j];
+			}
+			c[i][j] = (1 - c_1 - c_mu) * c[i][j] + c_1 * (p_c[i] * p_c[j] + lost * c[i][j]) + c_mu * rank_mu;
+		}
+	}
+	sigma *= std::exp(c_sigma / d_sigma * (p_sigma_norm / expected_norm - 1));
+
+	// rounding can cost the matrix its definiteness, a little of the
+	// identity brings it back
+	for (double jitter = 1e-12; !cholesky(c, a); jitter *= 10) {
+		for (int i = 0; i < n; i++) {
+			c[i][i] += jitter;
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "bots.h"
+#include "rng.h"
+#include "weights.h"
+
+// The search battleship-train runs over the weights of the tuned bot and
+// the score it gives them, apart from the program so they can be checked.
+
+using Vector = std::vector<double>;
+using Matrix = std::vector<Vector>;
+
+// density is fixed at 1, the search runs over the other weights
+const int tune_dims = features_num - 1;
+
+// the weights at point x of the search
+Weights weights_of(const Vector &x);
+
+// shots the bot needs to sink the fleet easy arranges with fleet_seed
+int shots_to_sink(WeightedPlayer &bot, uint64_t fleet_seed);
+
+// mean shots of every candidate over games [0, games) of the seed; game i
+// is the same fleet and the same bot seed for all of them
+Vector evaluate(const std::vector<Weights> &candidates, uint64_t seed, uint64_t games, int threads);
+
+// (mu/mu_w, lambda)-CMA-ES with the usual default constants, see Hansen's
+// "The CMA Evolution Strategy: A Tutorial"; the covariance is sampled
+// through its Cholesky factor instead of an eigendecomposition
+struct Cmaes {
+	Cmaes(const Vector &mean, double sigma, int lambda);
+
+	// lambda points to try around the mean
+	std::vector<Vector> ask(Rng &rng);
+
+	// fitness of xs from ask, lower is better
+	void tell(const std::vector<Vector> &xs, const Vector &fitness);
+
+	Vector mean;
+	double sigma;
+
+private:
+	int lambda;
+	int generation = 0;
+	Vector recombination;
+	double mu_eff;
+	double c_sigma;
+	double d_sigma;
+	double c_c;
+	double c_1;
+	double c_mu;
+	double expected_norm;
+	Vector p_sigma;
+	Vector p_c;
+	Matrix c;
+	Matrix a;
+};
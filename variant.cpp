@@ -0,0 +1,73 @@
+#include "sim.h"
+#include "variant.h"
+
+namespace {
+
+using Classic = Rules<10, 10, false, 4, 3, 3, 2, 2, 2, 1, 1, 1, 1>;
+using Touching = Rules<10, 10, true, 4, 3, 3, 2, 2, 2, 1, 1, 1, 1>;
+using Small = Rules<8, 8, false, 4, 3, 2, 2, 1, 1>;
+using Large = Rules<12, 12, false, 5, 4, 4, 3, 3, 3, 2, 2, 2, 2>;
+using Huge = Rules<16, 16, false, 6, 5, 4, 4, 3, 3, 3, 2, 2, 2, 2, 1, 1, 1, 1>;
+
+template <typename Bot1, typename Bot2>
+void play_games(uint64_t seed, uint64_t begin, uint64_t end, GameOutcome* out) {
+	for (uint64_t i = begin; i < end; i++) {
+		Bot1 bot1(stream_seed(seed, 2 * i));
+		Bot2 bot2(stream_seed(seed, 2 * i + 1));
+		bool swapped = i % 2 == 1;
+		MatchResult res = swapped ? play_match(bot2, bot1, false) : play_match(bot1, bot2, false);
+		out[i - begin] = GameOutcome{uint8_t(swapped ? 3 - res.winner : res.winner), uint16_t(res.shots)};
+	}
+}
+
+// calls f with a null pointer of the bot's type, false if there is no such bot
+template <typename R, typename F>
+bool visit_variant_bot(const std::string &name, F &&f) {
+	if (name == "easy") {
+		f(static_cast<VariantEasy<R>*>(nullptr));
+	} else if (name == "middle") {
+		f(static_cast<VariantMiddle<R>*>(nullptr));
+	} else {
+		return false;
+	}
+	return true;
+}
+
+template <typename R>
+bool play_variant(const std::string &bot1, const std::string &bot2, uint64_t seed, uint64_t begin, uint64_t end,
+		GameOutcome* out) {
+	bool known2 = false;
+	bool known1 = visit_variant_bot<R>(bot1, [&](auto* b1) {
+		known2 = visit_variant_bot<R>(bot2, [&](auto* b2) {
+			play_games<std::remove_pointer_t<decltype(b1)>, std::remove_pointer_t<decltype(b2)>>(seed, begin, end, out);
+		});
+	});
+	return known1 && known2;
+}
+
+const Variant variants[] = {
+	{"classic", "10x10, ships 4 3 3 2 2 2 1 1 1 1", play_variant<Classic>},
+	{"touching", "10x10, ships 4 3 3 2 2 2 1 1 1 1, ships may touch", play_variant<Touching>},
+	{"8x8", "8x8, ships 4 3 2 2 1 1", play_variant<Small>},
+	{"12x12", "12x12, ships 5 4 4 3 3 3 2 2 2 2", play_variant<Large>},
+	{"16x16", "16x16, ships 6 5 4 4 3 3 3 2 2 2 2 1 1 1 1", play_variant<Huge>},
+};
+
+}
+
+const Variant* find_variant(const std::string &name) {
+	for (const Variant &v : variants) {
+		if (name == v.name) {
+			return &v;
+		}
+	}
+	return nullptr;
+}
+
+std::string list_variants() {
+	std::string text;
+	for (const Variant &v : variants) {
+		text += std::string("  ") + v.name + ": " + v.rules + "\n";
+	}
+	return text;
+}
@@ -0,0 +1,561 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "batch.h"
+#include "board.h"
+#include "rng.h"
+
+// Rule variants: the field size, the fleet and whether ships may touch are
+// template parameters, so every variant gets its own engine with the sizes
+// and masks folded into the code. The engine is the headless one: fields,
+// random fleets, the easy and middle bots and play_match from sim.h. The
+// classic rules instantiated here play exactly the games the 10x10 engine
+// plays; the interface and the network stay on the 10x10 engine.
+
+// a set of N cells, cell i is bit i % 64 of word i / 64
+template <int N>
+struct BitSet {
+	static constexpr int words = (N + 63) / 64;
+	static constexpr uint64_t top_mask = N % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (N % 64)) - 1;
+
+	uint64_t w[words] = {};
+
+	static constexpr BitSet bit(int i) {
+		BitSet b;
+		b.w[i / 64] = uint64_t(1) << (i % 64);
+		return b;
+	}
+
+	static constexpr BitSet full() {
+		BitSet b;
+		for (int i = 0; i < words; i++) {
+			b.w[i] = ~uint64_t(0);
+		}
+		b.w[words - 1] = top_mask;
+		return b;
+	}
+
+	constexpr bool test(int i) const {
+		return (w[i / 64] >> (i % 64)) & 1;
+	}
+
+	constexpr bool empty() const {
+		uint64_t any = 0;
+		for (int i = 0; i < words; i++) {
+			any |= w[i];
+		}
+		return any == 0;
+	}
+
+	constexpr bool any() const {
+		return !empty();
+	}
+
+	int count() const {
+		int c = 0;
+		for (int i = 0; i < words; i++) {
+			c += __builtin_popcountll(w[i]);
+		}
+		return c;
+	}
+
+	// index of the n-th (from zero) set bit, n must be less than count()
+	int nth(int n) const {
+		int i = 0;
+		for (int c; n >= (c = __builtin_popcountll(w[i])); i++) {
+			n -= c;
+		}
+		return 64 * i + Bitboard{w[i], 0}.nth(n);
+	}
+
+	// by n cells towards the higher ones
+	constexpr BitSet shl(int n) const {
+		BitSet b;
+		int q = n / 64;
+		int r = n % 64;
+		for (int i = words - 1; i >= q; i--) {
+			b.w[i] = w[i - q] << r;
+			if (r != 0 && i - q > 0) {
+				b.w[i] |= w[i - q - 1] >> (64 - r);
+			}
+		}
+		b.w[words - 1] &= top_mask;
+		return b;
+	}
+
+	constexpr BitSet shr(int n) const {
+		BitSet b;
+		int q = n / 64;
+		int r = n % 64;
+		for (int i = 0; i + q < words; i++) {
+			b.w[i] = w[i + q] >> r;
+			if (r != 0 && i + q + 1 < words) {
+				b.w[i] |= w[i + q + 1] << (64 - r);
+			}
+		}
+		return b;
+	}
+
+	constexpr BitSet operator~() const {
+		BitSet b;
+		for (int i = 0; i < words; i++) {
+			b.w[i] = ~w[i];
+		}
+		b.w[words - 1] &= top_mask;
+		return b;
+	}
+
+	constexpr BitSet& operator&=(const BitSet &o) {
+		for (int i = 0; i < words; i++) {
+			w[i] &= o.w[i];
+		}
+		return *this;
+	}
+
+	constexpr BitSet& operator|=(const BitSet &o) {
+		for (int i = 0; i < words; i++) {
+			w[i] |= o.w[i];
+		}
+		return *this;
+	}
+
+	friend constexpr BitSet operator&(BitSet a, const BitSet &b) {
+		return a &= b;
+	}
+
+	friend constexpr BitSet operator|(BitSet a, const BitSet &b) {
+		return a |= b;
+	}
+
+	friend constexpr bool operator==(const BitSet &a, const BitSet &b) {
+		for (int i = 0; i < words; i++) {
+			if (a.w[i] != b.w[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	friend constexpr bool operator!=(const BitSet &a, const BitSet &b) {
+		return !(a == b);
+	}
+};
+
+// a width x height field, cell (x, y) is y * width + x; the fleet by the
+// lengths of its ships in the order they are arranged
+template <int Width, int Height, bool Touching, int... Lens>
+struct Rules {
+	static constexpr int width = Width;
+	static constexpr int height = Height;
+	static constexpr int cells = Width * Height;
+	// ships may touch each other, then a sunk ship tells nothing about its border
+	static constexpr bool touching = Touching;
+	static constexpr int fleet_size = sizeof...(Lens);
+	static constexpr int fleet_lens[fleet_size] = {Lens...};
+
+	using Bits = BitSet<cells>;
+};
+
+template <typename R>
+constexpr int longest_ship() {
+	int len = 0;
+	for (int l : R::fleet_lens) {
+		len = l > len ? l : len;
+	}
+	return len;
+}
+
+template <typename R>
+constexpr typename R::Bits column(int x) {
+	typename R::Bits b;
+	for (int y = 0; y < R::height; y++) {
+		b |= R::Bits::bit(y * R::width + x);
+	}
+	return b;
+}
+
+template <typename R>
+inline constexpr typename R::Bits not_left_of = ~column<R>(0);
+
+template <typename R>
+inline constexpr typename R::Bits not_right_of = ~column<R>(R::width - 1);
+
+// cells with even x + y
+template <typename R>
+inline constexpr typename R::Bits parity_of = [] {
+	typename R::Bits b;
+	for (int i = 0; i < R::cells; i++) {
+		if ((i % R::width + i / R::width) % 2 == 0) {
+			b |= R::Bits::bit(i);
+		}
+	}
+	return b;
+}();
+
+// cells where a ship of the given length can start, by orientation
+// (0 horizontal, 1 vertical)
+template <typename R>
+struct Anchors {
+	typename R::Bits cells[longest_ship<R>() + 1][2];
+};
+
+template <typename R>
+inline constexpr Anchors<R> anchors_of = [] {
+	Anchors<R> a{};
+	for (int len = 1; len <= longest_ship<R>(); len++) {
+		for (int y = 0; y < R::height; y++) {
+			for (int x = 0; x < R::width; x++) {
+				if (x + len <= R::width) {
+					a.cells[len][0] |= R::Bits::bit(y * R::width + x);
+				}
+				if (y + len <= R::height) {
+					a.cells[len][1] |= R::Bits::bit(y * R::width + x);
+				}
+			}
+		}
+	}
+	return a;
+}();
+
+template <typename R>
+constexpr typename R::Bits dilate_x(const typename R::Bits &b) {
+	return b | (b.shl(1) & not_left_of<R>) | (b.shr(1) & not_right_of<R>);
+}
+
+template <typename R>
+constexpr typename R::Bits dilate_y(const typename R::Bits &b) {
+	return b | b.shl(R::width) | b.shr(R::width);
+}
+
+template <typename R>
+constexpr typename R::Bits dilate4(const typename R::Bits &b) {
+	return dilate_x<R>(b) | dilate_y<R>(b);
+}
+
+template <typename R>
+constexpr typename R::Bits halo(const typename R::Bits &b) {
+	return dilate_y<R>(dilate_x<R>(b)) & ~b;
+}
+
+template <typename R>
+constexpr typename R::Bits ship_at(int len, int start, int orientation) {
+	typename R::Bits b;
+	for (int i = 0; i < len; i++) {
+		b |= R::Bits::bit(start + i * (orientation == 0 ? 1 : R::width));
+	}
+	return b;
+}
+
+// the same as Board, for any rules
+template <typename R>
+struct VariantBoard {
+	using Bits = typename R::Bits;
+
+	Bits ships;
+	Bits halo; // cells that can't hold a ship, empty when ships may touch
+	Bits misses;
+	Bits hits;
+	Bits sunk;
+	Bits fleet[R::fleet_size];
+	int ship_num = 0;
+	int alive_ships_num = 0;
+
+	bool can_place(const Bits &ship) const {
+		return (ship & (ships | halo)).empty();
+	}
+
+	void place(const Bits &ship) {
+		ships |= ship;
+		if (!R::touching) {
+			halo |= ::halo<R>(ship);
+		}
+		fleet[ship_num] = ship;
+		ship_num++;
+		alive_ships_num++;
+	}
+
+	ShotRes shoot(int cell) {
+		Bits shot = Bits::bit(cell);
+		if ((shot & ships).empty()) {
+			misses |= shot;
+			return ShotRes::miss;
+		}
+		if ((shot & hits).any()) {
+			return ShotRes::hit;
+		}
+
+		hits |= shot;
+		for (int i = 0; i < ship_num; i++) {
+			if ((fleet[i] & shot).any()) {
+				if ((fleet[i] & ~hits).any()) {
+					return ShotRes::hit;
+				}
+				sunk |= fleet[i];
+				alive_ships_num--;
+				break;
+			}
+		}
+		return alive_ships_num > 0 ? ShotRes::sank : ShotRes::game_over;
+	}
+
+	void record(ShotRes res, int cell) {
+		if (res == ShotRes::miss) {
+			misses |= Bits::bit(cell);
+		} else {
+			hits |= Bits::bit(cell);
+		}
+	}
+
+	// the ship sunk by the shot at the cell. Without touching it is all the
+	// hit cells connected to the cell. With touching those can belong to
+	// other ships too, so it is a straight run of open hits through the cell
+	// as long as a ship still afloat. If more than one run fits, only the
+	// cells they all share are marked and the sinking is tried again each
+	// time something else is marked
+	void mark_sunk(int cell) {
+		if (R::touching) {
+			sunk |= Bits::bit(cell);
+			pending[pending_num] = Sinking{cell, Bits::bit(cell)};
+			pending_num++;
+			resolve();
+			return;
+		}
+		Bits ship = Bits::bit(cell);
+		Bits grown = dilate4<R>(ship) & hits;
+		while (grown != ship) {
+			ship = grown;
+			grown = dilate4<R>(ship) & hits;
+		}
+		sunk |= ship;
+		halo |= ::halo<R>(ship);
+	}
+
+	Bits unknown() const {
+		return ~(misses | hits | halo);
+	}
+
+	VariantBoard() {
+		for (int len : R::fleet_lens) {
+			afloat[len]++;
+		}
+	}
+
+private:
+	// a sunk ship whose cells aren't all known, ship holds those that are
+	struct Sinking {
+		int cell;
+		Bits ship;
+	};
+
+	void resolve() {
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			for (int i = 0; i < pending_num; ) {
+				Sinking &s = pending[i];
+				int ship_len = 0;
+				int fits = 0;
+				Bits common = fit(s, ship_len, fits);
+				if (fits <= 1) {
+					if (fits == 1) {
+						sunk |= common;
+						afloat[ship_len]--;
+					}
+					pending_num--;
+					pending[i] = pending[pending_num];
+					changed = true;
+					continue;
+				}
+				if (common != s.ship) {
+					sunk |= common;
+					s.ship = common;
+					changed = true;
+				}
+				i++;
+			}
+		}
+	}
+
+	// the cells shared by all the runs the sunk ship can be, and how many
+	// runs there are; with one run ship_len is its length
+	Bits fit(const Sinking &s, int &ship_len, int &fits) const {
+		Bits allowed = (hits & ~sunk) | s.ship;
+		int x = s.cell % R::width;
+		int y = s.cell / R::width;
+		Bits common = Bits::full();
+		for (int len = 1; len <= longest_ship<R>(); len++) {
+			if (afloat[len] == 0) {
+				continue;
+			}
+			for (int orientation = 0; orientation < (len == 1 ? 1 : 2); orientation++) {
+				// the ship starts k cells before the cell
+				for (int k = 0; k < len; k++) {
+					int sx = orientation == 0 ? x - k : x;
+					int sy = orientation == 0 ? y : y - k;
+					if (sx < 0 || sy < 0 || (orientation == 0 ? sx + len > R::width : sy + len > R::height)) {
+						continue;
+					}
+					Bits run = ship_at<R>(len, sy * R::width + sx, orientation);
+					if ((run & ~allowed).empty() && (s.ship & ~run).empty()) {
+						common &= run;
+						ship_len = len;
+						fits++;
+					}
+				}
+			}
+		}
+		return common;
+	}
+
+	// ships of each length not marked sunk, counting the pending ones, so
+	// they never miss a ship that is still afloat
+	int afloat[longest_ship<R>() + 1] = {};
+	Sinking pending[R::fleet_size];
+	int pending_num = 0;
+};
+
+// the same draws as random_fleet, so the classic rules get the same fleets
+template <typename R>
+void random_fleet(Rng &rng, typename R::Bits* ships) {
+	using Bits = typename R::Bits;
+	while (true) {
+		Bits taken;
+		int s = 0;
+		for (; s < R::fleet_size; s++) {
+			int len = R::fleet_lens[s];
+			Bits free = ~taken;
+			Bits horizontal = free & anchors_of<R>.cells[len][0];
+			Bits vertical = free & anchors_of<R>.cells[len][1];
+			for (int k = 1; k < len; k++) {
+				horizontal &= free.shr(k);
+				vertical &= free.shr(R::width * k);
+			}
+			if (len == 1) {
+				vertical = Bits();
+			}
+
+			int h_num = horizontal.count();
+			int num = h_num + vertical.count();
+			if (num == 0) {
+				break;
+			}
+			int r = rng.below(num);
+			Bits ship = r < h_num ? ship_at<R>(len, horizontal.nth(r), 0) : ship_at<R>(len, vertical.nth(r - h_num), 1);
+			ships[s] = ship;
+			taken |= R::touching ? ship : ship | halo<R>(ship);
+		}
+		if (s == R::fleet_size) {
+			return;
+		}
+	}
+}
+
+// the bots below follow EasyPlayer and MiddlePlayer step by step; they
+// aren't AbstractPlayers but have the same calls, for play_match
+template <typename R>
+struct VariantBot {
+	explicit VariantBot(uint64_t seed) : rng(seed) {}
+
+	void arrange_ships() {
+		field_m = VariantBoard<R>();
+		other_field_m = VariantBoard<R>();
+		typename R::Bits ships[R::fleet_size];
+		random_fleet<R>(rng, ships);
+		for (const typename R::Bits &ship : ships) {
+			field_m.place(ship);
+		}
+	}
+
+	ShotRes get_shot(Coord xy) {
+		return field_m.shoot(xy.y * R::width + xy.x);
+	}
+
+	void game_res(GameRes) {}
+
+	VariantBoard<R> field_m;
+	VariantBoard<R> other_field_m;
+
+protected:
+	Coord pick(const typename R::Bits &cells) {
+		int i = cells.nth(rng.below(cells.count()));
+		return Coord{i % R::width, i / R::width};
+	}
+
+	Rng rng;
+};
+
+template <typename R>
+struct VariantEasy final : VariantBot<R> {
+	using VariantBot<R>::VariantBot;
+
+	const char* name() const {
+		return "easy";
+	}
+
+	Coord take_shot() {
+		return this->pick(this->other_field_m.unknown());
+	}
+
+	void get_res(ShotRes res, Coord shot) {
+		this->other_field_m.record(res, shot.y * R::width + shot.x);
+	}
+};
+
+template <typename R>
+struct VariantMiddle final : VariantBot<R> {
+	using VariantBot<R>::VariantBot;
+
+	const char* name() const {
+		return "middle";
+	}
+
+	Coord take_shot() {
+		using Bits = typename R::Bits;
+		const VariantBoard<R> &other = this->other_field_m;
+		Bits free = other.unknown();
+		Bits open_hits = other.hits & ~other.sunk;
+		Bits targets;
+
+		if (open_hits.count() > 1) {
+			bool horizontal = (open_hits & open_hits.shl(1) & not_left_of<R>).any();
+			targets = (horizontal ? dilate_x<R>(open_hits) : dilate_y<R>(open_hits)) & free;
+		}
+		// with touching ships the open hits may be of several ships, and
+		// the line may be done while the others aren't
+		if (targets.empty() && open_hits.any()) {
+			targets = dilate4<R>(open_hits) & free;
+		}
+
+		if (targets.empty()) {
+			targets = free & parity_of<R>;
+		}
+		if (targets.empty()) {
+			targets = free;
+		}
+		return this->pick(targets);
+	}
+
+	void get_res(ShotRes res, Coord shot) {
+		int cell = shot.y * R::width + shot.x;
+		this->other_field_m.record(res, cell);
+		if (res == ShotRes::sank) {
+			this->other_field_m.mark_sunk(cell);
+		}
+	}
+};
+
+// a variant in the registry; play runs games [begin, end) between the
+// named bots (easy or middle) seeded and seated as in the tournament,
+// and returns false if it doesn't know a bot
+struct Variant {
+	const char* name;
+	const char* rules;
+	bool (*play)(const std::string &bot1, const std::string &bot2, uint64_t seed, uint64_t begin, uint64_t end,
+		GameOutcome* out);
+};
+
+// nullptr if there is no such variant
+const Variant* find_variant(const std::string &name);
+
+// the names and rules of all variants, one per line
+std::string list_variants();
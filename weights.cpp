@@ -0,0 +1,60 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "weights.h"
+
+const char* feature_name(Feature f) {
+	static const char* const names[features_num] = {"density", "parity", "adjacency", "edge"};
+	return names[int(f)];
+}
+
+bool Weights::save(const char* path) const {
+	FILE* out = fopen(path, "w");
+	if (out == nullptr) {
+		return false;
+	}
+	for (int i = 0; i < features_num; i++) {
+		fprintf(out, "%s %.17g\n", feature_name(Feature(i)), w[i]);
+	}
+	return fclose(out) == 0;
+}
+
+bool Weights::load(const char* path) {
+	FILE* in = fopen(path, "r");
+	if (in == nullptr) {
+		return false;
+	}
+
+	Weights read = *this;
+	bool ok = true;
+	char line[256];
+	while (ok && fgets(line, sizeof line, in) != nullptr) {
+		char name[64];
+		char value[64];
+		char rest;
+		if (char* comment = strchr(line, '#')) {
+			*comment = '\0';
+		}
+		int fields = sscanf(line, "%63s %63s %c", name, value, &rest);
+		if (fields <= 0) {
+			continue;
+		}
+
+		int i = 0;
+		while (i < features_num && strcmp(name, feature_name(Feature(i))) != 0) {
+			i++;
+		}
+		char* end;
+		ok = fields == 2 && i < features_num;
+		if (ok) {
+			read.w[i] = strtod(value, &end);
+			ok = *end == '\0';
+		}
+	}
+	fclose(in);
+
+	if (ok) {
+		*this = read;
+	}
+	return ok;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+// terms of the score the tuned bot gives a cell it hasn't shot yet
+enum class Feature {
+	density,   // positions of the remaining ships through the cell, 1 for the densest cell
+	parity,    // 1 on the checkerboard of even x + y
+	adjacency, // 1 next to a hit of a ship that isn't sunk yet
+	edge       // 1 on the border of the field
+};
+
+const int features_num = 4;
+
+// the score is the weighted sum of the terms; scaling all weights by a
+// positive number doesn't change the shots, so density stays at 1 and
+// the trainer tunes the rest. The defaults play like hard
+struct Weights {
+	double w[features_num] = {1, 0, 0, 0};
+
+	double &operator[](Feature f) {
+		return w[int(f)];
+	}
+
+	double operator[](Feature f) const {
+		return w[int(f)];
+	}
+
+	// a text file of "name value" lines, # starts a comment
+	bool save(const char* path) const;
+
+	// false if the file is missing, has an unknown name or a bad value;
+	// the weights it doesn't name keep their values
+	bool load(const char* path);
+};
+
+const char* feature_name(Feature f);